@@ -0,0 +1,7 @@
+#--- Optional multi-threading (omp pragmas are simply ignored when missing)
+find_package(OpenMP)
+if(OPENMP_FOUND)
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+else()
+    message(STATUS "OpenMP not found (parallel kernels will run serially)")
+endif()
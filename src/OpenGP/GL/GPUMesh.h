@@ -3,6 +3,7 @@
 #include <OpenGP/GL/gl.h>
 #include <OpenGP/GL/Buffer.h>
 #include <OpenGP/GL/VertexArrayObject.h>
+#include <OpenGP/GL/Shader.h>
 
 #include <OpenGP/SurfaceMesh/SurfaceMesh.h>
 
@@ -114,6 +115,32 @@ public:
 
     }
 
+    /// Per-instance attribute, see Shader::set_instance_attribute()
+    template <class T>
+    void set_instance_attribute(Shader &shader, const char* name, ArrayBuffer<T> &buffer, size_t offset, int columns=1) {
+
+        vao.bind();
+
+        if (shader.has_attribute(name)) {
+            shader.set_instance_attribute(name, buffer, offset, columns);
+        }
+
+        vao.unbind();
+
+    }
+
+    void draw_instanced(int instances) {
+
+        vao.bind();
+        triangles.bind();
+
+        glDrawElementsInstanced(mode, element_count, GL_UNSIGNED_INT, 0, instances);
+
+        triangles.unbind();
+        vao.unbind();
+
+    }
+
     void draw() {
 
         vao.bind();
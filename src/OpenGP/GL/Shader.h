@@ -93,6 +93,24 @@ public:
     HEADERONLY_INLINE void set_attribute(const char* name, ArrayBuffer<Eigen::Vector3f>& buffer);
 /// @}
 
+/// @{ setters for *per-instance* vertex attributes (glVertexAttribDivisor)
+public:
+    /// Attribute \c name made of \c columns vec4 (4 for a mat4) read at byte \c offset
+    /// of each element of an interleaved buffer of T, advancing once per instance
+    template <class T>
+    void set_instance_attribute(const char* name, ArrayBuffer<T>& buffer, size_t offset, int columns=1) {
+        assert( check_is_current() );
+        GLint location = glGetAttribLocation(pid, name);
+        buffer.bind();
+        for (int i = 0; i < columns; ++i) {
+            glEnableVertexAttribArray(location + i);
+            glVertexAttribPointer(location + i, /*vec4*/ 4, GL_FLOAT, DONT_NORMALIZE, sizeof(T),
+                                  (const GLvoid*) (offset + i * 4 * sizeof(GLfloat)));
+            glVertexAttribDivisor(location + i, 1);
+        }
+    }
+/// @}
+
     HEADERONLY_INLINE bool has_attribute(const char* name);
 
 };
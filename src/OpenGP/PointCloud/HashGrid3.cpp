@@ -0,0 +1,112 @@
+#include "HashGrid3.h"
+#include <OpenGP/MLogger.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+HashGrid3::HashGrid3(const Vec3* points, int n, Scalar cell_size) : cell_size_(cell_size), inv_cell_size_(1/cell_size){
+    build(points, n);
+}
+
+HashGrid3::HashGrid3(const SurfaceMesh::Vertex_property<Vec3>& points, Scalar cell_size) : cell_size_(cell_size), inv_cell_size_(1/cell_size){
+    CHECK(points);
+    SurfaceMesh::Vertex_property<Vec3> vpoints = points;
+    build(vpoints.data(), (int) vpoints.vector().size());
+}
+
+HashGrid3::HashGrid3(const Mat3xN& points, Scalar cell_size) : cell_size_(cell_size), inv_cell_size_(1/cell_size){
+    build((const Vec3*) points.data(), (int) points.cols());
+}
+
+void HashGrid3::build(const Vec3* points, int n){
+    CHECK(cell_size_ > 0);
+    ///--- about two buckets per point keeps collisions rare
+    n_buckets_ = 1;
+    while(n_buckets_ < 2u*(unsigned int)n) n_buckets_ <<= 1;
+
+    std::vector<int> point_bucket(n);
+    #pragma omp parallel for
+    for(int i=0; i<n; ++i)
+        point_bucket[i] = bucket(cell(points[i]));
+
+    ///--- counting sort by bucket
+    bucket_begin_.assign(n_buckets_+1, 0);
+    for(int i=0; i<n; ++i)
+        ++bucket_begin_[point_bucket[i]+1];
+    for(unsigned int b=0; b<n_buckets_; ++b)
+        bucket_begin_[b+1] += bucket_begin_[b];
+    indices_.resize(n);
+    {
+        std::vector<int> fill(bucket_begin_.begin(), bucket_begin_.end()-1);
+        for(int i=0; i<n; ++i)
+            indices_[fill[point_bucket[i]]++] = i;
+    }
+    points_.resize(n);
+    #pragma omp parallel for
+    for(int i=0; i<n; ++i)
+        points_[i] = points[indices_[i]];
+}
+
+void HashGrid3::radius(const Vec3* queries, int n_queries, Scalar radius, std::vector<int>& offsets,
+                       std::vector<int>& indices, std::vector<Scalar>& sqdists) const{
+    ///--- each thread gathers a contiguous range of queries, ranges are then concatenated
+    offsets.assign(n_queries+1, 0);
+    std::vector<std::vector<int>> thread_indices;
+    std::vector<std::vector<Scalar>> thread_sqdists;
+    #pragma omp parallel
+    {
+        int n_threads = 1, t = 0;
+#ifdef _OPENMP
+        n_threads = omp_get_num_threads();
+        t = omp_get_thread_num();
+#endif
+        #pragma omp single
+        {
+            thread_indices.resize(n_threads);
+            thread_sqdists.resize(n_threads);
+        }
+        int q_begin = int((long long) n_queries * t / n_threads);
+        int q_end = int((long long) n_queries * (t+1) / n_threads);
+        std::vector<int>& local_indices = thread_indices[t];
+        std::vector<Scalar>& local_sqdists = thread_sqdists[t];
+        for(int i=q_begin; i<q_end; ++i){
+            for_each_neighbor(queries[i], radius, [&](int idx, Scalar d2){
+                local_indices.push_back(idx);
+                local_sqdists.push_back(d2);
+            });
+            offsets[i+1] = (int) local_indices.size();
+        }
+    }
+
+    ///--- local counts to global offsets
+    std::vector<int> thread_begin(thread_indices.size()+1, 0);
+    for(size_t t=0; t<thread_indices.size(); ++t)
+        thread_begin[t+1] = thread_begin[t] + (int) thread_indices[t].size();
+    int n_threads = (int) thread_indices.size();
+    for(int t=0; t<n_threads; ++t){
+        int q_begin = int((long long) n_queries * t / n_threads);
+        int q_end = int((long long) n_queries * (t+1) / n_threads);
+        for(int i=q_begin; i<q_end; ++i)
+            offsets[i+1] += thread_begin[t];
+    }
+    indices.resize(thread_begin.back());
+    sqdists.resize(thread_begin.back());
+    #pragma omp parallel for
+    for(int t=0; t<n_threads; ++t){
+        std::copy(thread_indices[t].begin(), thread_indices[t].end(), indices.begin()+thread_begin[t]);
+        std::copy(thread_sqdists[t].begin(), thread_sqdists[t].end(), sqdists.begin()+thread_begin[t]);
+    }
+}
+
+void HashGrid3::radius(const Mat3xN& queries, Scalar radius, std::vector<int>& offsets,
+                       std::vector<int>& indices, std::vector<Scalar>& sqdists) const{
+    this->radius((const Vec3*) queries.data(), (int) queries.cols(), radius, offsets, indices, sqdists);
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
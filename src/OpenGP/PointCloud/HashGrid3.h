@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Uniform grid over 3D points with hashed cells, for fixed-radius neighbor
+/// queries. Built with a counting sort: points are stored cell by cell in flat
+/// arrays (no per-cell containers), so that scanning a cell is a contiguous read.
+/// The points are copied; indices refer to the input order.
+class HashGrid3{
+public:
+    /// indexes \c n points with cells of size \c cell_size (typically the query radius)
+    HEADERONLY_INLINE HashGrid3(const Vec3* points, int n, Scalar cell_size);
+    /// indexes the vertex positions of a mesh (typically "v:point")
+    HEADERONLY_INLINE HashGrid3(const SurfaceMesh::Vertex_property<Vec3>& points, Scalar cell_size);
+    /// indexes the columns of \c points
+    HEADERONLY_INLINE HashGrid3(const Mat3xN& points, Scalar cell_size);
+
+    int size() const { return (int) indices_.size(); }
+    Scalar cell_size() const { return cell_size_; }
+
+    /// calls f(index, squared distance) for every point within \c radius of \c query
+    template <class F>
+    void for_each_neighbor(const Vec3& query, Scalar radius, F f) const;
+
+    /// all points within \c radius of each query, neighbors of query i are
+    /// [offsets[i], offsets[i+1]) in compressed (CSR) arrays. Runs in parallel.
+    HEADERONLY_INLINE void radius(const Vec3* queries, int n_queries, Scalar radius, std::vector<int>& offsets,
+                                  std::vector<int>& indices, std::vector<Scalar>& sqdists) const;
+    HEADERONLY_INLINE void radius(const Mat3xN& queries, Scalar radius, std::vector<int>& offsets,
+                                  std::vector<int>& indices, std::vector<Scalar>& sqdists) const;
+
+private:
+    HEADERONLY_INLINE void build(const Vec3* points, int n);
+    inline Eigen::Vector3i cell(const Vec3& p) const {
+        return Eigen::Vector3i(int(std::floor(p.x()*inv_cell_size_)),
+                               int(std::floor(p.y()*inv_cell_size_)),
+                               int(std::floor(p.z()*inv_cell_size_)));
+    }
+    inline int bucket(const Eigen::Vector3i& c) const {
+        unsigned int h = (unsigned int)(c.x())*73856093u ^ (unsigned int)(c.y())*19349663u ^ (unsigned int)(c.z())*83492791u;
+        return int(h & (n_buckets_-1));
+    }
+
+private:
+    Scalar cell_size_;
+    Scalar inv_cell_size_;
+    unsigned int n_buckets_ = 1;         ///< power of two
+    std::vector<int> bucket_begin_;      ///< points of bucket b are [bucket_begin_[b], bucket_begin_[b+1])
+    std::vector<int> indices_;           ///< input index of the sorted points
+    std::vector<Vec3> points_;           ///< points sorted by bucket
+};
+
+/// Centroids of the faces of a mesh (by face index), e.g. to build a HashGrid3 or KDTree3 over faces
+inline Mat3xN face_centroids(const SurfaceMesh& mesh){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    Mat3xN centroids = Mat3xN::Zero(3, mesh.faces_size());
+    for(auto f: mesh.faces()){
+        int n = 0;
+        for(auto v: mesh.vertices(f)){
+            centroids.col(f.idx()) += vpoints[v];
+            ++n;
+        }
+        centroids.col(f.idx()) /= n;
+    }
+    return centroids;
+}
+
+//=============================================================================
+
+template <class F>
+void HashGrid3::for_each_neighbor(const Vec3& query, Scalar radius, F f) const{
+    if(indices_.empty()) return;
+    Eigen::Vector3i lo = cell(query - Vec3::Constant(radius));
+    Eigen::Vector3i hi = cell(query + Vec3::Constant(radius));
+
+    ///--- distinct cells may share a bucket, every bucket is scanned once
+    int visited[27];
+    int n_visited = 0;
+    std::vector<int> many;
+    bool small = (hi-lo).maxCoeff() <= 2;
+    for(int x=lo.x(); x<=hi.x(); ++x)
+        for(int y=lo.y(); y<=hi.y(); ++y)
+            for(int z=lo.z(); z<=hi.z(); ++z){
+                int b = bucket(Eigen::Vector3i(x,y,z));
+                if(!small){ many.push_back(b); continue; }
+                if(std::find(visited, visited+n_visited, b) == visited+n_visited)
+                    visited[n_visited++] = b;
+            }
+    int* begin = visited;
+    int* end = visited+n_visited;
+    if(!small){
+        std::sort(many.begin(), many.end());
+        begin = many.data();
+        end = std::unique(many.begin(), many.end()) - many.begin() + many.data();
+    }
+
+    Scalar r2 = radius*radius;
+    for(int* b=begin; b!=end; ++b){
+        for(int i=bucket_begin_[*b]; i<bucket_begin_[*b+1]; ++i){
+            Scalar d2 = (points_[i]-query).squaredNorm();
+            if(d2 <= r2) f(indices_[i], d2);
+        }
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "HashGrid3.cpp"
+#endif
@@ -0,0 +1,128 @@
+#include "KDTree3.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+KDTree3::KDTree3(const SurfaceMesh::Vertex_property<Vec3>& points, int leaf_size) : vpoints_(points){
+    CHECK(vpoints_);
+    fetch();
+    index_.reset(new Index(3, points_, nanoflann::KDTreeSingleIndexAdaptorParams(leaf_size)));
+    index_->buildIndex();
+}
+
+KDTree3::KDTree3(const Mat3xN& points, int leaf_size) : mpoints_(&points){
+    fetch();
+    index_.reset(new Index(3, points_, nanoflann::KDTreeSingleIndexAdaptorParams(leaf_size)));
+    index_->buildIndex();
+}
+
+KDTree3::KDTree3(const Vec3* points, int n, int leaf_size){
+    points_.data = n ? points->data() : nullptr;
+    points_.n = n;
+    index_.reset(new Index(3, points_, nanoflann::KDTreeSingleIndexAdaptorParams(leaf_size)));
+    index_->buildIndex();
+}
+
+void KDTree3::fetch(){
+    ///--- the source may have been resized (and reallocated) since the last build
+    if(vpoints_){
+        const std::vector<Vec3>& v = vpoints_.vector();
+        points_.data = v.empty() ? nullptr : v[0].data();
+        points_.n = v.size();
+    } else if(mpoints_){
+        points_.data = mpoints_->data();
+        points_.n = mpoints_->cols();
+    }
+}
+
+void KDTree3::rebuild(){
+    fetch();
+    index_->buildIndex();
+    if(!snapshot_.empty())
+        snapshot_.assign((const Vec3*) points_.data, (const Vec3*) points_.data + points_.n);
+}
+
+bool KDTree3::update(Scalar tolerance){
+    const size_t n_old = points_.n;
+    fetch();
+    const Vec3* p = (const Vec3*) points_.data;
+    bool moved = (n_old != points_.n) || (snapshot_.size() != points_.n);
+    if(!moved){
+        Scalar tol2 = tolerance*tolerance;
+        int n = (int) points_.n;
+        #pragma omp parallel for reduction(||:moved)
+        for(int i=0; i<n; ++i)
+            moved = moved || (p[i]-snapshot_[i]).squaredNorm() > tol2;
+    }
+    if(!moved) return false;
+    index_->buildIndex();
+    snapshot_.assign(p, p + points_.n);
+    return true;
+}
+
+int KDTree3::knn(const Vec3& query, int k, int* indices, Scalar* sqdists) const{
+    if(points_.n==0 || k<=0) return 0;
+    nanoflann::KNNResultSet<Scalar,int,int> result(k);
+    result.init(indices, sqdists);
+    index_->findNeighbors(result, query.data(), nanoflann::SearchParams());
+    return result.size();
+}
+
+int KDTree3::closest(const Vec3& query, Scalar* sqdist) const{
+    int idx = -1;
+    Scalar d2 = inf();
+    knn(query, 1, &idx, &d2);
+    if(sqdist) *sqdist = d2;
+    return idx;
+}
+
+void KDTree3::radius(const Vec3& query, Scalar radius, std::vector<std::pair<int,Scalar>>& neighbors) const{
+    neighbors.clear();
+    if(points_.n==0) return;
+    /// nanoflann's L2 metric works with squared distances
+    index_->radiusSearch(query.data(), radius*radius, neighbors, nanoflann::SearchParams());
+}
+
+void KDTree3::knn(const Mat3xN& queries, int k, std::vector<int>& indices, std::vector<Scalar>& sqdists) const{
+    int nq = (int) queries.cols();
+    indices.assign(size_t(nq)*k, -1);
+    sqdists.assign(size_t(nq)*k, inf());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<nq; ++i){
+        Vec3 q = queries.col(i);
+        knn(q, k, &indices[size_t(i)*k], &sqdists[size_t(i)*k]);
+    }
+}
+
+void KDTree3::radius(const Mat3xN& queries, Scalar radius, std::vector<int>& offsets,
+                     std::vector<int>& indices, std::vector<Scalar>& sqdists) const{
+    int nq = (int) queries.cols();
+    std::vector<std::vector<std::pair<int,Scalar>>> found(nq);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<nq; ++i){
+        Vec3 q = queries.col(i);
+        this->radius(q, radius, found[i]);
+    }
+
+    ///--- prefix sum of the counts, then scatter
+    offsets.resize(nq+1);
+    offsets[0] = 0;
+    for(int i=0; i<nq; ++i)
+        offsets[i+1] = offsets[i] + (int) found[i].size();
+    indices.resize(offsets[nq]);
+    sqdists.resize(offsets[nq]);
+    #pragma omp parallel for
+    for(int i=0; i<nq; ++i){
+        for(size_t j=0; j<found[i].size(); ++j){
+            indices[offsets[i]+j] = found[i][j].first;
+            sqdists[offsets[i]+j] = found[i][j].second;
+        }
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
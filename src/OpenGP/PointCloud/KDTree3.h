@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <utility>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/external/nanoflann/nanoflann.hpp>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Zero-copy nanoflann dataset over a packed array of 3D points; a std::vector<Vec3>
+/// (e.g. "v:point") and a Mat3xN share the same layout
+struct KDTree3Points{
+    const Scalar* data = nullptr;
+    size_t n = 0;
+
+    inline size_t kdtree_get_point_count() const { return n; }
+    inline Scalar kdtree_get_pt(const size_t idx, int dim) const { return data[3*idx+dim]; }
+    inline Scalar kdtree_distance(const Scalar* p, const size_t idx, size_t /*size*/) const {
+        const Scalar* q = data + 3*idx;
+        Scalar d0 = p[0]-q[0], d1 = p[1]-q[1], d2 = p[2]-q[2];
+        return d0*d0 + d1*d1 + d2*d2;
+    }
+    template <class BBOX> bool kdtree_get_bbox(BBOX&) const { return false; }
+};
+
+/// k-d tree over 3D points for k-nearest-neighbor and radius queries. The points
+/// are referenced, not copied: the tree must be rebuilt (rebuild() or update())
+/// whenever they move. Indices are positions in the array, i.e. vertex indices
+/// when built over "v:point" (call garbage_collection() first if vertices were
+/// deleted). Batched queries run in parallel when OpenMP is enabled.
+class KDTree3{
+public:
+    typedef nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<Scalar, KDTree3Points>, KDTree3Points, 3, int> Index;
+
+    /// indexes the vertex positions of a mesh (typically "v:point")
+    HEADERONLY_INLINE KDTree3(const SurfaceMesh::Vertex_property<Vec3>& points, int leaf_size=10);
+    /// indexes the columns of \c points
+    HEADERONLY_INLINE KDTree3(const Mat3xN& points, int leaf_size=10);
+    /// indexes \c n points of a raw array
+    HEADERONLY_INLINE KDTree3(const Vec3* points, int n, int leaf_size=10);
+    KDTree3(const KDTree3&) = delete;
+    KDTree3& operator=(const KDTree3&) = delete;
+
+    /// rebuilds the tree from the current content of the referenced points
+    /// (the index memory is reused, point count may have changed)
+    HEADERONLY_INLINE void rebuild();
+    /// rebuilds only when a point moved farther than \c tolerance since the last
+    /// build (or when the count changed); returns whether the tree was rebuilt.
+    /// Until then query results are exact up to \c tolerance. The first call
+    /// always rebuilds, as it records the reference positions.
+    HEADERONLY_INLINE bool update(Scalar tolerance);
+
+    int size() const { return (int) points_.n; }
+
+    /// @{ single queries, distances are squared
+    /// writes up to \c k neighbors sorted by distance, returns how many were found
+    HEADERONLY_INLINE int knn(const Vec3& query, int k, int* indices, Scalar* sqdists) const;
+    /// index of the closest point (-1 if the tree is empty)
+    HEADERONLY_INLINE int closest(const Vec3& query, Scalar* sqdist=nullptr) const;
+    /// all points within \c radius of \c query, sorted by distance
+    HEADERONLY_INLINE void radius(const Vec3& query, Scalar radius, std::vector<std::pair<int,Scalar>>& neighbors) const;
+    /// @}
+
+    /// @{ batched queries over the columns of \c queries
+    /// \c k neighbors per query stored contiguously, missing ones are -1 / inf()
+    HEADERONLY_INLINE void knn(const Mat3xN& queries, int k, std::vector<int>& indices, std::vector<Scalar>& sqdists) const;
+    /// neighbors of query i are [offsets[i], offsets[i+1]) in compressed (CSR) arrays
+    HEADERONLY_INLINE void radius(const Mat3xN& queries, Scalar radius, std::vector<int>& offsets,
+                                  std::vector<int>& indices, std::vector<Scalar>& sqdists) const;
+    /// @}
+
+private:
+    HEADERONLY_INLINE void fetch();
+
+private:
+    SurfaceMesh::Vertex_property<Vec3> vpoints_; ///< source when built over a mesh
+    const Mat3xN* mpoints_ = nullptr;             ///< source when built over a matrix
+    KDTree3Points points_;
+    std::unique_ptr<Index> index_;
+    std::vector<Vec3> snapshot_;                  ///< positions at last build, only kept by update()
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "KDTree3.cpp"
+#endif
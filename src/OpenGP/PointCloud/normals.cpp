@@ -0,0 +1,147 @@
+#include "normals.h"
+#include <OpenGP/MLogger.h>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+Vec3 smallest_eigenvector(const Eigen::Matrix3d& C){
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+    solver.computeDirect(C, Eigen::ComputeEigenvectors); ///< eigenvalues sorted increasingly
+    return solver.eigenvectors().col(0).cast<Scalar>().normalized();
+}
+
+void estimate_normals(const Vec3* points, int n, const KDTree3& tree, int k, Vec3* normals, std::vector<int>& knn){
+    CHECK(k>=3);
+    knn.assign(size_t(n)*k, -1);
+    #pragma omp parallel
+    {
+        std::vector<Scalar> sqdists(k);
+        #pragma omp for schedule(dynamic, 1024)
+        for(int i=0; i<n; ++i){
+            int* nbrs = &knn[size_t(i)*k];
+            int m = tree.knn(points[i], k, nbrs, sqdists.data());
+
+            ///--- covariance of the neighborhood (double: scans are often far from the origin)
+            Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+            for(int j=0; j<m; ++j)
+                mean += points[nbrs[j]].cast<double>();
+            mean /= std::max(m,1);
+            Eigen::Matrix3d C = Eigen::Matrix3d::Zero();
+            for(int j=0; j<m; ++j){
+                Eigen::Vector3d d = points[nbrs[j]].cast<double>() - mean;
+                C += d * d.transpose();
+            }
+            normals[i] = (m<3) ? Vec3(0,0,0) : smallest_eigenvector(C);
+        }
+    }
+}
+
+void orient_normals(const Vec3* points, int n, const std::vector<int>& knn, int k, Vec3* normals){
+    CHECK(knn.size() == size_t(n)*k);
+    const int n_buckets = 1024;
+    const size_t n_edges = knn.size(); ///< edge e goes from e/k to knn[e]
+
+    ///--- quantized weights 1-|n_i.n_j|, edges counting-sorted by weight (Kruskal order)
+    std::vector<short> bucket(n_edges);
+    #pragma omp parallel for
+    for(int i=0; i<n; ++i){
+        for(int j=0; j<k; ++j){
+            size_t e = size_t(i)*k+j;
+            int nb = knn[e];
+            if(nb<0 || nb==i){ bucket[e] = -1; continue; }
+            Scalar w = 1 - std::abs(normals[i].dot(normals[nb]));
+            bucket[e] = (short) std::min(n_buckets-1, std::max(0, int(w*n_buckets)));
+        }
+    }
+    std::vector<size_t> bucket_begin(n_buckets+1, 0);
+    for(size_t e=0; e<n_edges; ++e)
+        if(bucket[e]>=0) ++bucket_begin[bucket[e]+1];
+    for(int b=0; b<n_buckets; ++b)
+        bucket_begin[b+1] += bucket_begin[b];
+    std::vector<size_t> sorted(bucket_begin[n_buckets]);
+    for(size_t e=0; e<n_edges; ++e)
+        if(bucket[e]>=0) sorted[bucket_begin[bucket[e]]++] = e;
+    std::vector<short>().swap(bucket);
+
+    ///--- Kruskal: union-find over the sorted edges keeps the spanning forest
+    std::vector<int> parent(n);
+    for(int i=0; i<n; ++i) parent[i] = i;
+    auto find = [&](int i){
+        while(parent[i]!=i){ parent[i] = parent[parent[i]]; i = parent[i]; }
+        return i;
+    };
+    std::vector<int> tree_begin(n+1, 0);
+    std::vector<std::pair<int,int>> tree_edges;
+    tree_edges.reserve(n);
+    for(size_t e: sorted){
+        int u = int(e/k), v = knn[e];
+        int ru = find(u), rv = find(v);
+        if(ru==rv) continue;
+        parent[ru] = rv;
+        tree_edges.push_back(std::make_pair(u,v));
+        ++tree_begin[u+1];
+        ++tree_begin[v+1];
+    }
+    std::vector<size_t>().swap(sorted);
+
+    ///--- spanning forest adjacency (CSR)
+    for(int i=0; i<n; ++i)
+        tree_begin[i+1] += tree_begin[i];
+    std::vector<int> tree_adj(tree_begin[n]);
+    {
+        std::vector<int> fill(tree_begin.begin(), tree_begin.end()-1);
+        for(const auto& uv: tree_edges){
+            tree_adj[fill[uv.first]++] = uv.second;
+            tree_adj[fill[uv.second]++] = uv.first;
+        }
+    }
+
+    ///--- each tree is seeded at its topmost point
+    std::vector<int> seed(n, -1);
+    for(int i=0; i<n; ++i){
+        int r = find(i);
+        if(seed[r]<0 || points[i].z() > points[seed[r]].z())
+            seed[r] = i;
+    }
+
+    ///--- propagation (breadth first) along the trees
+    std::vector<char> visited(n, 0);
+    std::vector<int> queue;
+    queue.reserve(n);
+    for(int r=0; r<n; ++r){
+        if(seed[r]<0) continue;
+        int s = seed[r];
+        if(normals[s].z() < 0) normals[s] = -normals[s];
+        visited[s] = 1;
+        queue.push_back(s);
+    }
+    for(size_t q=0; q<queue.size(); ++q){
+        int u = queue[q];
+        for(int e=tree_begin[u]; e<tree_begin[u+1]; ++e){
+            int v = tree_adj[e];
+            if(visited[v]) continue;
+            visited[v] = 1;
+            if(normals[v].dot(normals[u]) < 0) normals[v] = -normals[v];
+            queue.push_back(v);
+        }
+    }
+}
+
+void estimate_normals(SurfaceMesh& cloud, int k, bool orient){
+    SurfaceMesh::Vertex_property<Vec3> vpoints = cloud.get_vertex_property<Vec3>("v:point");
+    SurfaceMesh::Vertex_property<Vec3> vnormals = cloud.vertex_property<Vec3>("v:normal");
+    int n = cloud.vertices_size();
+    if(n==0) return;
+    KDTree3 tree(vpoints);
+    std::vector<int> knn;
+    estimate_normals(vpoints.data(), n, tree, k, vnormals.vector().data(), knn);
+    if(orient)
+        orient_normals(vpoints.data(), n, knn, k, vnormals.vector().data());
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
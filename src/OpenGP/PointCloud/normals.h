@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/PointCloud/KDTree3.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Unit eigenvector of the smallest eigenvalue of a symmetric 3x3 matrix (closed form)
+HEADERONLY_INLINE Vec3 smallest_eigenvector(const Eigen::Matrix3d& C);
+
+/// PCA normals (unoriented) over the \c k nearest neighbors of each of the \c n points.
+/// The neighborhoods are returned in \c knn (k per point, see KDTree3::knn) so that
+/// orient_normals() can reuse them. Runs in parallel when OpenMP is enabled.
+HEADERONLY_INLINE void estimate_normals(const Vec3* points, int n, const KDTree3& tree, int k,
+                                        Vec3* normals, std::vector<int>& knn);
+
+/// Consistent orientation (Hoppe et al. '92): normals are flipped while propagating
+/// along a minimum spanning forest of the kNN graph weighted by 1-|n_i.n_j|, each
+/// tree starting from its topmost point whose normal is made to point up (+z).
+/// Weights are quantized so that Kruskal's edge order is a linear-time counting sort.
+HEADERONLY_INLINE void orient_normals(const Vec3* points, int n, const std::vector<int>& knn, int k, Vec3* normals);
+
+/// Computes "v:normal" of a point cloud (a mesh with or without faces)
+HEADERONLY_INLINE void estimate_normals(SurfaceMesh& cloud, int k=10, bool orient=true);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "normals.cpp"
+#endif
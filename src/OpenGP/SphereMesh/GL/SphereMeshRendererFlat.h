@@ -1,12 +1,12 @@
 #pragma once
 
-#include <iostream>
+#include <cstddef>
 
 #include <OpenGP/SphereMesh/SphereMesh.h>
 #include <OpenGP/GL/GPUMesh.h>
 #include <OpenGP/GL/SceneGraph.h>
 #include <OpenGP/SphereMesh/bounding_box.h>
-#include <OpenGP/SphereMesh/helpers.h>
+#include <OpenGP/SphereMesh/SphereMeshInstances.h>
 
 
 //=============================================================================
@@ -19,15 +19,6 @@ private:
     const GLchar* vshader = R"GLSL(
         #version 330 core
 
-        uniform float ratio;
-        uniform float nrotate;
-
-        uniform vec3 v0;
-        uniform vec3 v1;
-        uniform vec3 v2;
-        uniform vec3 vn;
-        uniform float vweight;
-
         uniform mat4 M;
         uniform mat4 MV;
         uniform mat4 MVP;
@@ -35,6 +26,13 @@ private:
         in vec3 vposition;   ///< per-vertex position
         in vec3 vnormal;     ///< per-vertex normal
 
+        in mat4 imodel;      ///< per-instance transform of the unit geometry
+        in vec4 iparams;     ///< per-instance (ratio, nrotate, vweight, -)
+        in vec4 iv0;         ///< per-instance triangle corners and normal
+        in vec4 iv1;
+        in vec4 iv2;
+        in vec4 ivn;
+
         out vec3 fnormal;    ///< per-fragment normal
 
         /// http://www.neilmendoza.com/glsl-rotation-about-an-arbitrary-axis/
@@ -51,20 +49,24 @@ private:
         }
 
         void main(){
+            float ratio = iparams.x;
+            float nrotate = iparams.y;
+            float vweight = iparams.z;
+
             vec3 vpos_prime = vposition;
             vpos_prime.x *= 1 + vpos_prime.z * (ratio - 1);
             vpos_prime.y *= 1 + vpos_prime.z * (ratio - 1);
 
-            vec3 tpos = vpos_prime.x * v0 + vpos_prime.y * v1 + vpos_prime.z * v2;
+            vec3 tpos = vpos_prime.x * iv0.xyz + vpos_prime.y * iv1.xyz + vpos_prime.z * iv2.xyz;
             vpos_prime = mix(vpos_prime, tpos, vweight);
 
-            gl_Position = MVP * vec4(vpos_prime, 1.0);
+            gl_Position = MVP * imodel * vec4(vpos_prime, 1.0);
 
-            vec3 vnorm_prime = mix(vnormal, vn, vweight);
+            vec3 vnorm_prime = mix(vnormal, ivn.xyz, vweight);
             vec3 axis = cross(vnorm_prime, vec3(0, 0, 1));
             mat4 rot = rotationMatrix(axis, nrotate);
             vnorm_prime = (rot * vec4(vnorm_prime, 1)).xyz;
-            fnormal = normalize( inverse(transpose(mat3(MV))) * vnorm_prime );
+            fnormal = normalize( inverse(transpose(mat3(MV) * mat3(imodel))) * vnorm_prime );
         }
     )GLSL";
 
@@ -93,6 +95,9 @@ private:
 
     GPUMesh sphere, cone, triangle;
 
+    SphereMeshInstances instances;
+    ArrayBuffer<SphereMeshInstance> sphere_instances, cone_instances, triangle_instances;
+
 public:
 
     SphereMeshRendererFlat(SphereMesh &mesh) : mesh(mesh) {
@@ -197,183 +202,26 @@ public:
 
     void display() {
 
-        auto vpoint = mesh.get_vertex_property<Vec4>("v:point");
-
-        sphere.set_attributes(program);
-
-        Mat4x4 MV, MVP, V, VP;
-        program.get_uniform("MV", MV);
-        program.get_uniform("MVP", MVP);
-        V = MV * model.inverse();
-        VP = MVP * model.inverse();
-
-        auto draw_sphere = [&](SphereMesh::Vertex v){
-
-            Vec4 point = vpoint[v];
-
-            Mat4x4 t = Eigen::Affine3f(Eigen::Translation3f(point.block<3, 1>(0, 0))).matrix();
-            Mat4x4 s = Mat4x4::Identity();
-            s(0, 0) = s(1, 1) = s(2, 2) = point(3);
-
-            Mat4x4 M = model * t * s;
-
-            program.set_uniform("M", M);
-            program.set_uniform("MV", Mat4x4(V * M));
-            program.set_uniform("MVP", Mat4x4(VP * M));
-            program.set_uniform("ratio", 1.0f);
-            program.set_uniform("vweight", 0.0f);
-            program.set_uniform("nrotate", 0.0f);
-
-            sphere.draw();
-
+        ///--- all transforms computed on the CPU in one pass, then one instanced draw per shape
+        sphere_mesh_instances(mesh, instances);
+
+        auto draw = [&](GPUMesh &shape, ArrayBuffer<SphereMeshInstance> &buffer,
+                        const std::vector<SphereMeshInstance> &data) {
+            if (data.empty()) return;
+            buffer.upload(data, GL_STREAM_DRAW);
+            shape.set_attributes(program);
+            shape.set_instance_attribute(program, "imodel", buffer, offsetof(SphereMeshInstance, model), 4);
+            shape.set_instance_attribute(program, "iparams", buffer, offsetof(SphereMeshInstance, ratio));
+            shape.set_instance_attribute(program, "iv0", buffer, offsetof(SphereMeshInstance, v0));
+            shape.set_instance_attribute(program, "iv1", buffer, offsetof(SphereMeshInstance, v1));
+            shape.set_instance_attribute(program, "iv2", buffer, offsetof(SphereMeshInstance, v2));
+            shape.set_instance_attribute(program, "ivn", buffer, offsetof(SphereMeshInstance, vn));
+            shape.draw_instanced(data.size());
         };
 
-        for (auto s : mesh.spheres()) {
-            draw_sphere(mesh.vertex(s));
-        }
-
-        for (auto e : mesh.edges()) {
-            draw_sphere(mesh.vertex(e, 0));
-            draw_sphere(mesh.vertex(e, 1));
-        }
-
-        for (auto f : mesh.faces()) {
-            draw_sphere(mesh.vertex(f, 0));
-            draw_sphere(mesh.vertex(f, 1));
-            draw_sphere(mesh.vertex(f, 2));
-        }
-
-        cone.set_attributes(program);
-
-        auto draw_cone = [&](SphereMesh::Vertex v0, SphereMesh::Vertex v1) {
-
-            Vec4 s0 = vpoint[v0];
-            Vec4 s1 = vpoint[v1];
-            Vec3 p0 = s0.block<3, 1>(0, 0);
-            Vec3 p1 = s1.block<3, 1>(0, 0);
-            Scalar r0 = s0(3);
-            Scalar r1 = s1(3);
-
-            Vec2 tangent = pill_tangent(s0, s1);
-            Scalar beta = tangent(0);
-            Scalar alpha = tangent(1);
-
-            Scalar angle = std::acos(Vec3(0, 0, 1).dot((p1 - p0).normalized()));
-            Vec3 axis = Vec3(0, 0, 1).cross(p1 - p0).normalized();
-            Mat4x4 r = Eigen::Affine3f(Eigen::AngleAxis<Scalar>(angle, axis)).matrix();
-
-            Mat4x4 s = Mat4x4::Identity();
-            Vec3 o;
-            s(0, 0) = s(1, 1) = r0 * beta;
-            if (r1 > r0) {
-                s(2, 2) = (p1 - p0).norm() + alpha * (r0 - r1);
-                o = -alpha * r0 * (p1 - p0).normalized();
-            } else {
-                s(2, 2) = (p1 - p0).norm() + alpha * (r1 - r0);
-                o = alpha * r0 * (p1 - p0).normalized();
-            }
-
-            Mat4x4 t = Eigen::Affine3f(Eigen::Translation3f(p0 + o)).matrix();
-
-            Scalar ratio = r1 / r0;
-            Scalar nrotate = std::atan2(beta * (r1 - r0), s(2, 2));
-
-            Mat4x4 M = model * t * r * s;
-
-            program.set_uniform("M", M);
-            program.set_uniform("MV", Mat4x4(V * M));
-            program.set_uniform("MVP", Mat4x4(VP * M));
-            program.set_uniform("ratio", ratio);
-            program.set_uniform("vweight", 0.0f);
-            program.set_uniform("nrotate", nrotate);
-
-            cone.draw();
-
-        };
-
-        for (auto e : mesh.edges()) {
-            draw_cone(mesh.vertex(e, 0), mesh.vertex(e, 1));
-        }
-
-        for (auto f : mesh.faces()) {
-            draw_cone(mesh.vertex(f, 0), mesh.vertex(f, 1));
-            draw_cone(mesh.vertex(f, 1), mesh.vertex(f, 2));
-            draw_cone(mesh.vertex(f, 2), mesh.vertex(f, 0));
-        }
-
-        triangle.set_attributes(program);
-
-        auto draw_triangles = [&](SphereMesh::Vertex v0, SphereMesh::Vertex v1, SphereMesh::Vertex v2) {
-
-            Vec4 s0 = vpoint[v0];
-            Vec4 s1 = vpoint[v1];
-            Vec4 s2 = vpoint[v2];
-            Vec3 p0 = s0.block<3, 1>(0, 0);
-            Vec3 p1 = s1.block<3, 1>(0, 0);
-            Vec3 p2 = s2.block<3, 1>(0, 0);
-            Scalar r0 = s0(3);
-            Scalar r1 = s1(3);
-            Scalar r2 = s2(3);
-
-            Vec3 sn = (p2 - p0).cross(p1 - p0).normalized();
-
-            Vec2 ta, tb;
-            Vec3 ms_tangent_a, ms_tangent_b, tn;
-            ta = pill_tangent(s0, s1);
-            tb = pill_tangent(s0, s2);
-            ms_tangent_a = ta(0) * (p1 - p0).normalized() - ta(1) * sn;
-            ms_tangent_b = tb(0) * (p2 - p0).normalized() - tb(1) * sn;
-            tn = ms_tangent_a.cross(ms_tangent_b).normalized();
-
-            // tangent point 0
-            Vec3 t0 = p0 + r0 * tn;
-
-            // tangent point 1
-            Vec3 t1 = p1 + r1 * tn;
-
-            // tangent point 2
-            Vec3 t2 = p2 + r2 * tn;
-
-            Mat4x4 M = Mat4x4::Identity();
-
-            program.set_uniform("M", M);
-            program.set_uniform("MV", Mat4x4(V * M));
-            program.set_uniform("MVP", Mat4x4(VP * M));
-            program.set_uniform("ratio", 1.0f);
-            program.set_uniform("v0", t0);
-            program.set_uniform("v1", t1);
-            program.set_uniform("v2", t2);
-            program.set_uniform("vn", tn);
-            program.set_uniform("vweight", 1.0f);
-            program.set_uniform("nrotate", 0.0f);
-
-            triangle.draw();
-
-            ms_tangent_a = ta(0) * (p1 - p0).normalized() + ta(1) * sn;
-            ms_tangent_b = tb(0) * (p2 - p0).normalized() + tb(1) * sn;
-            tn = ms_tangent_b.cross(ms_tangent_a).normalized();
-
-            // tangent point 0
-            t0 = p0 + r0 * tn;
-
-            // tangent point 1
-            t1 = p1 + r1 * tn;
-
-            // tangent point 2
-            t2 = p2 + r2 * tn;
-
-            program.set_uniform("v0", t0);
-            program.set_uniform("v1", t1);
-            program.set_uniform("v2", t2);
-            program.set_uniform("vn", tn);
-
-            triangle.draw();
-
-        };
-
-        for (auto f : mesh.faces()) {
-            draw_triangles(mesh.vertex(f, 0), mesh.vertex(f, 1), mesh.vertex(f, 2));
-        }
+        draw(sphere, sphere_instances, instances.spheres);
+        draw(cone, cone_instances, instances.cones);
+        draw(triangle, triangle_instances, instances.triangles);
 
     }
 
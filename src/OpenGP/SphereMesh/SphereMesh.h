@@ -1,9 +1,16 @@
 #pragma once
 
 #include <vector>
-#include <regex>
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
 
 #include <OpenGP/types.h>
 #include <OpenGP/SurfaceMesh/internal/Global_properties.h>
@@ -14,6 +21,103 @@
 namespace OpenGP {
 //=============================================================================
 
+namespace internal {
+
+static const char sphere_mesh_binary_header[8] = { 'S', 'P', 'H', 'M', 'E', 'S', 'H', '1' };
+
+inline bool sphere_mesh_has_binary_header(const char* begin, const char* end) {
+    return end - begin >= 8 && std::memcmp(begin, sphere_mesh_binary_header, 8) == 0;
+}
+
+/// skips spaces, tabs, carriage returns and empty lines
+inline void sphere_mesh_skip_blanks(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+}
+
+/// non-negative integer, preceded by spaces or tabs
+inline bool sphere_mesh_parse_index(const char*& p, const char* end, int& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    const char* first = p;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9' && v <= std::numeric_limits<int>::max()) v = 10*v + (*p++ - '0');
+    if (p == first || v > std::numeric_limits<int>::max()) return false;
+    value = (int) v;
+    return true;
+}
+
+/// decimal number with optional sign, fraction and exponent, preceded by spaces or tabs
+inline bool sphere_mesh_parse_scalar(const char*& p, const char* end, Scalar& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        if (mantissa < 100000000000000000ull) mantissa = 10*mantissa + (*p - '0');
+        else ++exponent;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (mantissa < 100000000000000000ull) { mantissa = 10*mantissa + (*p - '0'); --exponent; }
+        }
+    }
+    if (digits == 0) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = false;
+        if (p < end && (*p == '-' || *p == '+')) negative_exponent = (*p++ == '-');
+        int e = 0;
+        const char* first = p;
+        while (p < end && *p >= '0' && *p <= '9') e = std::min(10*e + (*p++ - '0'), 10000);
+        if (p == first) return false;
+        exponent += negative_exponent ? -e : e;
+    }
+
+    ///--- powers up to 1e22 are exact in double, the common case needs a single rounding
+    static const double powers[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    double v = (double) mantissa;
+    if (exponent < 0 && exponent >= -22) v /= powers[-exponent];
+    else if (exponent > 0 && exponent <= 22) v *= powers[exponent];
+    else if (exponent != 0 && mantissa != 0) v *= std::pow(10.0, exponent);
+    value = Scalar(negative ? -v : v);
+    return true;
+}
+
+/// Exclusive prefix sum of the 0/1 flags in \c map, over per-thread ranges: kept
+/// elements receive their new index, the others -1. Returns the number kept.
+inline int sphere_mesh_compaction_map(std::vector<int>& map) {
+    int n = (int) map.size();
+    std::vector<int> thread_begin;
+    #pragma omp parallel
+    {
+        int n_threads = 1, t = 0;
+#ifdef _OPENMP
+        n_threads = omp_get_num_threads();
+        t = omp_get_thread_num();
+#endif
+        #pragma omp single
+        thread_begin.assign(n_threads + 1, 0);
+
+        int begin = int((long long) n * t / n_threads);
+        int end = int((long long) n * (t+1) / n_threads);
+        int count = 0;
+        for (int i = begin; i < end; ++i) count += map[i];
+        thread_begin[t+1] = count;
+        #pragma omp barrier
+
+        #pragma omp single
+        for (int k = 0; k < n_threads; ++k) thread_begin[k+1] += thread_begin[k];
+
+        int next = thread_begin[t];
+        for (int i = begin; i < end; ++i) map[i] = map[i] ? next++ : -1;
+    }
+    return thread_begin.back();
+}
+
+} // internal
+
 class SphereMesh : public Global_properties {
 public:
 
@@ -58,7 +162,9 @@ public:
 
     public:
 
-        HandleIterator(H h=H(0), const SphereMesh *m=nullptr) : handle(h), mesh(m) {}
+        HandleIterator(H h=H(0), const SphereMesh *m=nullptr) : mesh(m), handle(h) {
+            if (mesh && mesh->garbage()) while (mesh->is_valid(handle) && mesh->is_deleted(handle)) ++handle._idx;
+        }
 
         H operator*() const { return handle; }
 
@@ -73,12 +179,14 @@ public:
         HandleIterator &operator++() {
             assert(mesh);
             ++handle._idx;
+            while (mesh->garbage() && mesh->is_valid(handle) && mesh->is_deleted(handle)) ++handle._idx;
             return *this;
         }
 
         HandleIterator &operator--() {
             assert(mesh);
             --handle._idx;
+            while (mesh->garbage() && mesh->is_valid(handle) && mesh->is_deleted(handle)) --handle._idx;
             return *this;
         }
 
@@ -197,6 +305,14 @@ public:
         econn  = add_edge_property<EdgeConnectivity>("e:connectivity");
         fconn  = add_face_property<FaceConnectivity>("f:connectivity");
         vpoint = add_vertex_property<Point>("v:point");
+
+        vdeleted = add_vertex_property<bool>("v:deleted", false);
+        sdeleted = add_sphere_property<bool>("s:deleted", false);
+        edeleted = add_edge_property<bool>("e:deleted", false);
+        fdeleted = add_face_property<bool>("f:deleted", false);
+
+        deleted_vertices = deleted_spheres = deleted_edges = deleted_faces = 0;
+        has_garbage = false;
     }
 
     virtual ~SphereMesh() {}
@@ -252,48 +368,65 @@ public:
         fconn[*(--(faces_end()))] = FaceConnectivity(v0.idx(), v1.idx(), v2.idx());
     }
 
+    /// Deletes \c v and the spheres, edges and faces using it
     void delete_vertex(Vertex v) {
+        delete_vertices(std::vector<Vertex>(1, v));
+    }
 
-        if (vdeleted[v]) return;
+    /// Deletes the vertices and the spheres, edges and faces using any of them,
+    /// found in a single parallel pass over the elements
+    void delete_vertices(const std::vector<Vertex>& vertices) {
 
-        std::vector<Sphere> spheres_to_delete;
-        std::vector<Edge> edges_to_delete;
-        std::vector<Face> faces_to_delete;
+        bool any = false;
+        for (auto v : vertices) {
+            if (vdeleted[v]) continue;
+            vdeleted[v] = true;
+            deleted_vertices++;
+            any = true;
+        }
+        if (!any) return;
+        has_garbage = true;
 
-        for (auto s : spheres()) {
-            if (Vertex(sconn[s]) == v) {
-                spheres_to_delete.push_back(s);
+        ///--- std::vector<bool> flags cannot be written concurrently, collect them first
+        int nS = spheres_size(), nE = edges_size(), nF = faces_size();
+        std::vector<char> sflag(nS), eflag(nE), fflag(nF);
+
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nS; ++i) {
+                sflag[i] = vdeleted[Vertex(sconn[Sphere(i)])];
             }
-        }
 
-        for (auto e : edges()) {
-            if (Vertex(econn[e](0)) == v || Vertex(econn[e](1)) == v) {
-                edges_to_delete.push_back(e);
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nE; ++i) {
+                const EdgeConnectivity& c = econn[Edge(i)];
+                eflag[i] = vdeleted[Vertex(c(0))] || vdeleted[Vertex(c(1))];
             }
-        }
 
-        for (auto f : faces()) {
-            if (Vertex(fconn[f](0)) == v || Vertex(fconn[f](1)) == v || Vertex(fconn[f](2)) == v) {
-                faces_to_delete.push_back(f);
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nF; ++i) {
+                const FaceConnectivity& c = fconn[Face(i)];
+                fflag[i] = vdeleted[Vertex(c(0))] || vdeleted[Vertex(c(1))] || vdeleted[Vertex(c(2))];
             }
         }
 
-        for (auto s : spheres_to_delete) {
-            delete_sphere(s);
-        }
+        for (int i = 0; i < nS; ++i) if (sflag[i]) delete_sphere(Sphere(i));
+        for (int i = 0; i < nE; ++i) if (eflag[i]) delete_edge(Edge(i));
+        for (int i = 0; i < nF; ++i) if (fflag[i]) delete_face(Face(i));
 
-        for (auto e : edges_to_delete) {
-            delete_edge(e);
-        }
+    }
 
-        for (auto f : faces_to_delete) {
-            delete_face(f);
-        }
+    void delete_spheres(const std::vector<Sphere>& spheres) {
+        for (auto s : spheres) delete_sphere(s);
+    }
 
-        vdeleted[v] = true;
-        deleted_vertices++;
-        has_garbage = true;
+    void delete_edges(const std::vector<Edge>& edges) {
+        for (auto e : edges) delete_edge(e);
+    }
 
+    void delete_faces(const std::vector<Face>& faces) {
+        for (auto f : faces) delete_face(f);
     }
 
     void delete_sphere(Sphere s) {
@@ -326,6 +459,11 @@ public:
 
     }
 
+    bool is_deleted(Vertex v) const { return vdeleted[v]; }
+    bool is_deleted(Sphere s) const { return sdeleted[s]; }
+    bool is_deleted(Edge e) const { return edeleted[e]; }
+    bool is_deleted(Face f) const { return fdeleted[f]; }
+
     Vertex vertex(Sphere s) const { return Vertex(sconn[s]); }
     Vertex vertex(Edge e, int i) const { assert(i < 2 && i > -1); return Vertex(econn[e](i)); }
     Vertex vertex(Face f, int i) const { assert(i < 3 && i > -1); return Vertex(fconn[f](i)); }
@@ -355,10 +493,10 @@ public:
     unsigned int n_edges() const { return edges_size() - deleted_edges; }
     unsigned int n_faces() const { return faces_size() - deleted_faces; }
 
-    bool is_valid(Vertex v) const { return v.idx() != 0 && v.idx() < vertices_size(); }
-    bool is_valid(Sphere s) const { return s.idx() != 0 && s.idx() < spheres_size(); }
-    bool is_valid(Edge e) const { return e.idx() != 0 && e.idx() < edges_size(); }
-    bool is_valid(Face f) const { return f.idx() != 0 && f.idx() < faces_size(); }
+    bool is_valid(Vertex v) const { return v.idx() >= 0 && v.idx() < (int) vertices_size(); }
+    bool is_valid(Sphere s) const { return s.idx() >= 0 && s.idx() < (int) spheres_size(); }
+    bool is_valid(Edge e) const { return e.idx() >= 0 && e.idx() < (int) edges_size(); }
+    bool is_valid(Face f) const { return f.idx() >= 0 && f.idx() < (int) faces_size(); }
 
     template <class T>
     VertexProperty<T> add_vertex_property(const std::string& name, const T t=T()) {
@@ -459,79 +597,157 @@ public:
         return fprops.get_type(name);
     }
 
+    /// reads the text format (v/s/p/w records) or, recognized by its header, the binary format
     bool read(const std::string& filename) {
 
-        std::ifstream file_stream(filename, std::ios_base::in);
+        std::ifstream file_stream(filename, std::ios_base::in | std::ios_base::binary);
 
         if (!file_stream.is_open()) {
             return false;
         }
 
-        std::string text((std::istreambuf_iterator<char>(file_stream)), std::istreambuf_iterator<char>());
+        file_stream.seekg(0, std::ios_base::end);
+        std::streamoff size = file_stream.tellg();
+        file_stream.seekg(0, std::ios_base::beg);
+        if (size < 0) return false;
+
+        std::vector<char> buffer((size_t) size);
+        if (size > 0 && !file_stream.read(buffer.data(), size)) {
+            return false;
+        }
 
-        return read_text(text);
+        const char* begin = buffer.data();
+        const char* end = begin + buffer.size();
+        if (internal::sphere_mesh_has_binary_header(begin, end)) {
+            return read_binary(begin, end);
+        }
+        return read_text(begin, end);
 
     }
 
     bool read_text(const std::string& text) {
+        return read_text(text.data(), text.data() + text.size());
+    }
+
+    /// Single pass over [begin, end): one record per line ("v x y z r",
+    /// "s v", "p v0 v1", "w v0 v1 v2"), other lines are ignored. Records are
+    /// collected in flat arrays and appended to the properties at once. Returns
+    /// false (leaving the mesh unchanged) on a malformed record.
+    bool read_text(const char* begin, const char* end) {
+
+        std::vector<Point> points;
+        std::vector<int> spheres, edges, faces;
+        points.reserve((end - begin) / 32);
+
+        const char* p = begin;
+        while (p < end) {
+
+            internal::sphere_mesh_skip_blanks(p, end);
+            if (p == end) break;
+
+            char type = *p++;
+            bool ok = true;
+            bool record = (p == end || *p == ' ' || *p == '\t');
+            if (record && type == 'v') {
+                Point point;
+                for (int k = 0; k < 4 && ok; ++k) ok = internal::sphere_mesh_parse_scalar(p, end, point(k));
+                if (ok) points.push_back(point);
+            } else if (record && type == 's') {
+                int v = 0;
+                ok = internal::sphere_mesh_parse_index(p, end, v);
+                if (ok) spheres.push_back(v);
+            } else if (record && type == 'p') {
+                int v[2];
+                for (int k = 0; k < 2 && ok; ++k) ok = internal::sphere_mesh_parse_index(p, end, v[k]);
+                if (ok) edges.insert(edges.end(), v, v+2);
+            } else if (record && type == 'w') {
+                int v[3];
+                for (int k = 0; k < 3 && ok; ++k) ok = internal::sphere_mesh_parse_index(p, end, v[k]);
+                if (ok) faces.insert(faces.end(), v, v+3);
+            }
+            if (!ok) return false;
 
-        std::regex vert_regex(R"regex(v\s+([\d\-\.]+)\s+([\d\-\.]+)\s+([\d\-\.]+)\s+([\d\-\.]+))regex");
-
-        std::sregex_iterator verts_begin(text.begin(), text.end(), vert_regex);
-        std::sregex_iterator verts_end;
-
-        for (auto i = verts_begin;i != verts_end;++i) {
-
-            auto match = *i;
-
-            vprops.push_back();
-            auto it = vertices_end();
-            vpoint[*(--it)] = Point(std::stof(match[1]), std::stof(match[2]), std::stof(match[3]), std::stof(match[4]));
+            // rest of the line
+            const char* eol = (const char*) std::memchr(p, '\n', end - p);
+            p = eol ? eol + 1 : end;
 
         }
 
-        std::regex sphere_regex(R"regex(s\s+([\d]+))regex");
-        std::sregex_iterator spheres_begin(text.begin(), text.end(), sphere_regex);
-        std::sregex_iterator spheres_end;
+        if (!valid_indices(points.size(), spheres, edges, faces)) return false;
+        append(points, spheres, edges, faces);
+        return true;
 
-        for (auto i = spheres_begin;i != spheres_end;++i) {
+    }
 
-            auto match = *i;
+    /// Binary format for cached models: the 8 byte header "SPHMESH1", the number
+    /// of vertices, spheres, edges and faces (uint32), then float x, y, z, r per
+    /// vertex and int32 indices per sphere (1), edge (2) and face (3), all in
+    /// native (little endian on all supported platforms) byte order.
+    /// Deleted elements are skipped, indices refer to the vertices as compacted
+    /// by garbage_collection().
+    bool write_binary(const std::string& filename) const {
 
-            sprops.push_back();
-            auto it = this->spheres_end();
-            sconn[*(--it)] = std::stoi(match[1]);
+        std::ofstream file_stream(filename, std::ios_base::out | std::ios_base::binary);
 
+        if (!file_stream.is_open()) {
+            return false;
         }
 
-        std::regex edge_regex(R"regex(p\s+([\d]+)\s+([\d]+))regex");
-        std::sregex_iterator edges_begin(text.begin(), text.end(), edge_regex);
-        std::sregex_iterator edges_end;
+        std::vector<int> vmap;
+        vertex_compaction_map(vmap);
 
-        for (auto i = edges_begin;i != edges_end;++i) {
+        uint32_t counts[4] = { (uint32_t) n_vertices(), (uint32_t) n_spheres(),
+                               (uint32_t) n_edges(), (uint32_t) n_faces() };
+        file_stream.write(internal::sphere_mesh_binary_header, 8);
+        file_stream.write((const char*) counts, sizeof(counts));
 
-            auto match = *i;
+        std::vector<float> points(4 * counts[0]);
+        for (auto v : vertices())
+            for (int k = 0; k < 4; ++k) points[4*vmap[v.idx()] + k] = (float) vpoint[v](k);
+        std::vector<int32_t> indices;
+        indices.reserve(counts[1] + 2*counts[2] + 3*counts[3]);
+        for (auto s : spheres()) indices.push_back(vmap[sconn[s]]);
+        for (auto e : edges())
+            for (int k = 0; k < 2; ++k) indices.push_back(vmap[econn[e](k)]);
+        for (auto f : faces())
+            for (int k = 0; k < 3; ++k) indices.push_back(vmap[fconn[f](k)]);
 
-            eprops.push_back();
-            auto it = this->edges_end();
-            econn[*(--it)] = EdgeConnectivity(std::stoi(match[1]), std::stoi(match[2]));
+        file_stream.write((const char*) points.data(), points.size() * sizeof(float));
+        file_stream.write((const char*) indices.data(), indices.size() * sizeof(int32_t));
+        return (bool) file_stream;
 
-        }
+    }
 
-        std::regex face_regex(R"regex(w\s+([\d]+)\s+([\d]+)\s+([\d]+))regex");
-        std::sregex_iterator faces_begin(text.begin(), text.end(), face_regex);
-        std::sregex_iterator faces_end;
+    bool read_binary(const char* begin, const char* end) {
 
-        for (auto i = faces_begin;i != faces_end;++i) {
+        if (!internal::sphere_mesh_has_binary_header(begin, end)) return false;
+        const char* p = begin + 8;
 
-            auto match = *i;
+        uint32_t counts[4];
+        if (end - p < (std::ptrdiff_t) sizeof(counts)) return false;
+        std::memcpy(counts, p, sizeof(counts));
+        p += sizeof(counts);
 
-            fprops.push_back();
-            auto it = this->faces_end();
-            fconn[*(--it)] = FaceConnectivity(std::stoi(match[1]), std::stoi(match[2]), std::stoi(match[3]));
+        size_t n_floats = 4 * (size_t) counts[0];
+        size_t n_indices = counts[1] + 2 * (size_t) counts[2] + 3 * (size_t) counts[3];
+        if ((size_t) (end - p) != n_floats * sizeof(float) + n_indices * sizeof(int32_t)) return false;
 
-        }
+        std::vector<float> floats(n_floats);
+        std::vector<int32_t> indices(n_indices);
+        if (n_floats > 0) std::memcpy(floats.data(), p, n_floats * sizeof(float));
+        p += n_floats * sizeof(float);
+        if (n_indices > 0) std::memcpy(indices.data(), p, n_indices * sizeof(int32_t));
+
+        std::vector<Point> points(counts[0]);
+        for (size_t i = 0; i < points.size(); ++i)
+            points[i] = Point(floats[4*i], floats[4*i+1], floats[4*i+2], floats[4*i+3]);
+        auto it = indices.begin();
+        std::vector<int> spheres(it, it + counts[1]); it += counts[1];
+        std::vector<int> edges(it, it + 2 * (size_t) counts[2]); it += 2 * (size_t) counts[2];
+        std::vector<int> faces(it, indices.end());
 
+        if (!valid_indices(points.size(), spheres, edges, faces)) return false;
+        append(points, spheres, edges, faces);
         return true;
 
     }
@@ -552,8 +768,12 @@ public:
 
     }
 
+    /// Deleted elements are skipped, see write_binary()
     std::string write_text() const {
 
+        std::vector<int> vmap;
+        vertex_compaction_map(vmap);
+
         std::string text;
 
         for (auto v : vertices()) {
@@ -566,7 +786,7 @@ public:
         }
 
         for (auto s : spheres()) {
-            auto sphere = sconn[s];
+            auto sphere = vmap[sconn[s]];
             text += "s ";
             text += std::to_string(sphere) + "\n";
         }
@@ -574,155 +794,121 @@ public:
         for (auto e : edges()) {
             auto edge = econn[e];
             text += "p ";
-            text += std::to_string(edge(0)) + " ";
-            text += std::to_string(edge(1)) + "\n";
+            text += std::to_string(vmap[edge(0)]) + " ";
+            text += std::to_string(vmap[edge(1)]) + "\n";
         }
 
         for (auto f : faces()) {
             auto face = fconn[f];
             text += "w ";
-            text += std::to_string(face(0)) + " ";
-            text += std::to_string(face(1)) + " ";
-            text += std::to_string(face(2)) + "\n";
+            text += std::to_string(vmap[face(0)]) + " ";
+            text += std::to_string(vmap[face(1)]) + " ";
+            text += std::to_string(vmap[face(2)]) + "\n";
         }
 
         return text;
 
     }
 
-    bool garbage() const { return has_garbage; }
-
-    void garbage_collection() {
-
-        int  i, i0, i1,
-        nV(vertices_size()),
-        nS(spheres_size()),
-        nE(edges_size()),
-        nF(faces_size());
-
-        VertexProperty<Vertex> vmap = add_vertex_property<Vertex>("v:garbage-collection");
-
-        for (i = 0;i < nV;i++) {
-            vmap[Vertex(i)] = Vertex(i);
-        }
-
-        // remove deleted vertices
-        if (nV > 0) {
-            i0=0;  i1=nV-1;
-
-            while (1) {
-                // find first deleted and last un-deleted
-                while (!vdeleted[Vertex(i0)] && i0 < i1)  ++i0;
-                while ( vdeleted[Vertex(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                vprops.swap(i0, i1);
-            };
-
-            // remember new size
-            nV = vdeleted[Vertex(i0)] ? i0 : i0+1;
-        }
-
-        VertexProperty<Vertex> vmap_reverse = add_vertex_property<Vertex>("v:garbage-collection-2");
-
-        for (i = 0;i < nV;i++) {
-
-            Vertex vnew(i);
-            Vertex vold = vmap[vnew];
-
-            vmap_reverse[vold] = vnew;
-
-        }
-
-        // remove deleted spheres
-        if (nS > 0) {
-            i0=0;  i1=nS-1;
-
-            while (1) {
-                // find first deleted and last un-deleted
-                while (!sdeleted[Sphere(i0)] && i0 < i1)  ++i0;
-                while ( sdeleted[Sphere(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                sprops.swap(i0, i1);
-            };
-
-            // remember new size
-            nS = sdeleted[Sphere(i0)] ? i0 : i0+1;
-        }
-
-        // remove deleted edges
-        if (nE > 0) {
-            i0=0;  i1=nE-1;
-
-            while (1) {
-                // find first deleted and last un-deleted
-                while (!edeleted[Edge(i0)] && i0 < i1)  ++i0;
-                while ( edeleted[Edge(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                eprops.swap(i0, i1);
-            };
-
-            // remember new size
-            nE = edeleted[Edge(i0)] ? i0 : i0+1;
-        }
-
-        // remove deleted faces
-        if (nF > 0) {
-            i0=0;  i1=nF-1;
+private:
 
-            while (1) {
-                // find first deleted and last un-deleted
-                while (!fdeleted[Face(i0)] && i0 < i1)  ++i0;
-                while ( fdeleted[Face(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
+    /// new index of each vertex once the deleted ones are removed (-1 for those),
+    /// returns the number of vertices kept
+    int vertex_compaction_map(std::vector<int>& vmap) const {
+        int nV = vertices_size();
+        vmap.resize(nV);
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < nV; ++i) vmap[i] = !vdeleted[Vertex(i)];
+        return internal::sphere_mesh_compaction_map(vmap);
+    }
+
+    /// true if all indices refer to existing or \c n_new_points appended vertices
+    bool valid_indices(size_t n_new_points, const std::vector<int>& spheres,
+                       const std::vector<int>& edges, const std::vector<int>& faces) const {
+        long long n = (long long) vertices_size() + (long long) n_new_points;
+        for (const std::vector<int>* indices : { &spheres, &edges, &faces })
+            for (int i : *indices)
+                if (i < 0 || i >= n) return false;
+        return true;
+    }
 
-                // swap
-                fprops.swap(i0, i1);
-            };
+    /// resizes the property containers once and fills the new elements
+    void append(const std::vector<Point>& points, const std::vector<int>& spheres,
+                const std::vector<int>& edges, const std::vector<int>& faces) {
 
-            // remember new size
-            nF = fdeleted[Face(i0)] ? i0 : i0+1;
-        }
+        size_t v0 = vprops.size(), s0 = sprops.size(), e0 = eprops.size(), f0 = fprops.size();
+        vprops.resize(v0 + points.size());
+        sprops.resize(s0 + spheres.size());
+        eprops.resize(e0 + edges.size() / 2);
+        fprops.resize(f0 + faces.size() / 3);
 
-        for (i = 0;i < nV;i++) {
+        std::copy(points.begin(), points.end(), vpoint.vector().begin() + v0);
+        std::copy(spheres.begin(), spheres.end(), sconn.vector().begin() + s0);
+        for (size_t i = 0; i < edges.size() / 2; ++i)
+            econn[Edge(int(e0 + i))] = EdgeConnectivity(edges[2*i], edges[2*i+1]);
+        for (size_t i = 0; i < faces.size() / 3; ++i)
+            fconn[Face(int(f0 + i))] = FaceConnectivity(faces[3*i], faces[3*i+1], faces[3*i+2]);
 
-            Sphere s(i);
+    }
 
-            sconn[s] = vmap_reverse[Vertex(sconn[s])].idx();
+public:
 
-        }
+    bool garbage() const { return has_garbage; }
 
-        for (i = 0;i < nE;i++) {
+    /// Removes the deleted elements, keeping the others in order: new indices come
+    /// from parallel prefix sums over the kept flags, connectivity is remapped and
+    /// every property array compacted in one pass each.
+    void garbage_collection() {
 
-            Edge e(i);
+        if (!has_garbage) return;
 
-            econn[e](0) = vmap_reverse[Vertex(econn[e](0))].idx();
-            econn[e](1) = vmap_reverse[Vertex(econn[e](1))].idx();
+        int nV = vertices_size(), nS = spheres_size(), nE = edges_size(), nF = faces_size();
+        std::vector<int> vmap, smap(nS), emap(nE), fmap(nF);
+        int nV_kept = vertex_compaction_map(vmap);
 
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nS; ++i) smap[i] = !sdeleted[Sphere(i)];
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nE; ++i) emap[i] = !edeleted[Edge(i)];
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nF; ++i) fmap[i] = !fdeleted[Face(i)];
         }
 
-        for (i = 0;i < nF;i++) {
+        int nS_kept = internal::sphere_mesh_compaction_map(smap);
+        int nE_kept = internal::sphere_mesh_compaction_map(emap);
+        int nF_kept = internal::sphere_mesh_compaction_map(fmap);
 
-            Face f(i);
+        ///--- kept elements only use kept vertices (see delete_vertices)
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nS; ++i) {
+                if (smap[i] < 0) continue;
+                SphereConnectivity& c = sconn[Sphere(i)];
+                c = vmap[c];
+            }
 
-            fconn[f](0) = vmap_reverse[Vertex(fconn[f](0))].idx();
-            fconn[f](1) = vmap_reverse[Vertex(fconn[f](1))].idx();
-            fconn[f](2) = vmap_reverse[Vertex(fconn[f](2))].idx();
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nE; ++i) {
+                if (emap[i] < 0) continue;
+                EdgeConnectivity& c = econn[Edge(i)];
+                c = EdgeConnectivity(vmap[c(0)], vmap[c(1)]);
+            }
 
+            #pragma omp for schedule(static) nowait
+            for (int i = 0; i < nF; ++i) {
+                if (fmap[i] < 0) continue;
+                FaceConnectivity& c = fconn[Face(i)];
+                c = FaceConnectivity(vmap[c(0)], vmap[c(1)], vmap[c(2)]);
+            }
         }
 
-        remove_vertex_property(vmap);
-        remove_vertex_property(vmap_reverse);
-
-        vprops.resize(nV); vprops.free_memory();
-        sprops.resize(nS); sprops.free_memory();
-        eprops.resize(nE); eprops.free_memory();
-        fprops.resize(nF); fprops.free_memory();
+        vprops.compact(vmap, nV_kept);
+        sprops.compact(smap, nS_kept);
+        eprops.compact(emap, nE_kept);
+        fprops.compact(fmap, nF_kept);
 
         deleted_vertices = deleted_spheres = deleted_edges = deleted_faces = 0;
         has_garbage = false;
@@ -0,0 +1,322 @@
+#include "SphereMeshDistance.h"
+#include <OpenGP/MLogger.h>
+#include <OpenGP/SphereMesh/bounding_box.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// a unit vector orthogonal to the unit vector a
+inline Vec3 sphere_mesh_orthogonal(const Vec3& a){
+    Vec3 t = (std::abs(a.x()) < Scalar(0.9)) ? Vec3(1,0,0) : Vec3(0,1,0);
+    return (t - a.dot(t)*a).normalized();
+}
+
+inline Scalar sphere_distance(const Vec3& p, const Vec3& c, Scalar r, Vec3& normal){
+    Vec3 v = p - c;
+    Scalar l = v.norm();
+    normal = (l > 0) ? Vec3(v/l) : Vec3(0,0,1);
+    return l - r;
+}
+
+/// The tangent cone of two spheres, in the plane of the axis and p: with x along
+/// the axis and y the distance to it, its generator has normal (sin, cos) and
+/// touches the spheres where the foot of p, s = x cos - y sin, is 0 and L cos.
+inline Scalar pill_distance(const Vec3& p, const Vec3& c0, Scalar r0, const Vec3& c1, Scalar r1, Vec3& normal){
+    Vec3 d = c1 - c0;
+    Scalar L = d.norm();
+    if(L <= std::abs(r1 - r0))
+        return (r0 >= r1) ? sphere_distance(p, c0, r0, normal) : sphere_distance(p, c1, r1, normal);
+    Vec3 a = d/L;
+    Vec3 v = p - c0;
+    Scalar x = v.dot(a);
+    Vec3 radial = v - x*a;
+    Scalar y = radial.norm();
+    Scalar sin = (r0 - r1)/L;
+    Scalar cos = std::sqrt(std::max(1 - sin*sin, Scalar(0)));
+    Scalar s = x*cos - y*sin;
+    if(s <= 0) return sphere_distance(p, c0, r0, normal);
+    if(s >= L*cos) return sphere_distance(p, c1, r1, normal);
+    Vec3 rho = (y > 0) ? Vec3(radial/y) : sphere_mesh_orthogonal(a);
+    normal = sin*a + cos*rho;
+    return x*sin + y*cos - r0;
+}
+
+/// Planes n.x = offset tangent to the three spheres (n.c_i + r_i = offset), on the
+/// positive and the negative side of the plane of the centers. False if they do
+/// not exist, e.g. for collinear centers or a sphere containing the others.
+inline bool wedge_planes(const Vec3* c, const Scalar* r, Vec3* normals, Scalar* offsets){
+    Vec3 e1 = c[1] - c[0], e2 = c[2] - c[0];
+    Vec3 m = e1.cross(e2);
+    Scalar det = m.squaredNorm();
+    Scalar g11 = e1.squaredNorm(), g12 = e1.dot(e2), g22 = e2.squaredNorm();
+    if(det <= std::numeric_limits<Scalar>::epsilon() * g11 * g22) return false;
+    ///--- in-plane part of n: n.e1 = r0-r1, n.e2 = r0-r2
+    Scalar b1 = r[0] - r[1], b2 = r[0] - r[2];
+    Scalar alpha = (g22*b1 - g12*b2) / det;
+    Scalar beta = (g11*b2 - g12*b1) / det;
+    Vec3 np = alpha*e1 + beta*e2;
+    Scalar np2 = np.squaredNorm();
+    if(np2 >= 1) return false;
+    Vec3 mn = m / std::sqrt(det);
+    Scalar gamma = std::sqrt(1 - np2);
+    normals[0] = np + gamma*mn;
+    normals[1] = np - gamma*mn;
+    for(int j=0; j<2; ++j)
+        offsets[j] = normals[j].dot(c[0]) + r[0];
+    return true;
+}
+
+/// The minimum over the wedge of |p - c| - r is either at a tangent plane (where
+/// the foot of p lies within the triangle of tangent points) or on a pill.
+inline Scalar wedge_distance(const Vec3& p, const Vec3* c, const Scalar* r, const Vec3* normals, const Scalar* offsets,
+                             bool has_planes, Vec3& normal){
+    if(has_planes){
+        ///--- the tangent plane on the side of p
+        int j = ((normals[0] - normals[1]).dot(p - c[0]) >= 0) ? 0 : 1;
+        const Vec3& n = normals[j];
+        Scalar f = n.dot(p) - offsets[j];
+        Vec3 q = p - f*n;
+        Vec3 t[3];
+        for(int i=0; i<3; ++i)
+            t[i] = c[i] + r[i]*n;
+        Vec3 N = (t[1]-t[0]).cross(t[2]-t[0]);
+        bool inside = true;
+        for(int i=0; i<3 && inside; ++i)
+            inside = N.dot((t[(i+1)%3]-q).cross(t[(i+2)%3]-q)) >= 0;
+        if(inside){
+            normal = n;
+            return f;
+        }
+    }
+    Scalar best = inf();
+    for(int i=0; i<3; ++i){
+        Vec3 n;
+        Scalar d = pill_distance(p, c[i], r[i], c[(i+1)%3], r[(i+1)%3], n);
+        if(d < best){
+            best = d;
+            normal = n;
+        }
+    }
+    return best;
+}
+
+} // internal
+
+Scalar sphere_distance(const Vec3& p, const Vec4& s, Vec3& normal){
+    return internal::sphere_distance(p, s.head<3>(), s(3), normal);
+}
+
+Scalar pill_distance(const Vec3& p, const Vec4& s0, const Vec4& s1, Vec3& normal){
+    return internal::pill_distance(p, s0.head<3>(), s0(3), s1.head<3>(), s1(3), normal);
+}
+
+Scalar wedge_distance(const Vec3& p, const Vec4& s0, const Vec4& s1, const Vec4& s2, Vec3& normal){
+    Vec3 c[3] = { s0.head<3>(), s1.head<3>(), s2.head<3>() };
+    Scalar r[3] = { s0(3), s1(3), s2(3) };
+    Vec3 normals[2];
+    Scalar offsets[2];
+    bool has_planes = internal::wedge_planes(c, r, normals, offsets);
+    return internal::wedge_distance(p, c, r, normals, offsets, has_planes, normal);
+}
+
+//=============================================================================
+
+SphereMeshDistance::SphereMeshDistance(const SphereMesh& mesh){
+    n_spheres = mesh.spheres_size();
+    n_edges = mesh.edges_size();
+    n_faces = mesh.faces_size();
+    std::vector<Box3> boxes;
+    live_primitives(mesh, ids, boxes);
+    bvh.build(boxes);
+    load_primitives(mesh);
+}
+
+bool SphereMeshDistance::update(const SphereMesh& mesh, Scalar max_degradation){
+    CHECK(n_spheres == (int) mesh.spheres_size() && n_edges == (int) mesh.edges_size() && n_faces == (int) mesh.faces_size());
+    std::vector<int> live;
+    std::vector<Box3> boxes;
+    live_primitives(mesh, live, boxes);
+    bool rebuilt = true;
+    if(live == ids){
+        rebuilt = bvh.update(boxes, max_degradation);
+    } else {
+        ids.swap(live);
+        bvh.build(boxes);
+    }
+    load_primitives(mesh);
+    return rebuilt;
+}
+
+void SphereMeshDistance::live_primitives(const SphereMesh& mesh, std::vector<int>& live, std::vector<Box3>& boxes) const{
+    std::vector<Box3> all;
+    primitive_boxes(mesh, all);
+    live.clear();
+    boxes.clear();
+    for(int i=0; i<(int) all.size(); ++i){
+        bool deleted;
+        switch(primitive_type(i)){
+        case PRIMITIVE_SPHERE: deleted = mesh.is_deleted(SphereMesh::Sphere(primitive_element(i))); break;
+        case PRIMITIVE_PILL: deleted = mesh.is_deleted(SphereMesh::Edge(primitive_element(i))); break;
+        default: deleted = mesh.is_deleted(SphereMesh::Face(primitive_element(i)));
+        }
+        if(deleted) continue;
+        live.push_back(i);
+        boxes.push_back(all[i]);
+    }
+}
+
+void SphereMeshDistance::load_primitives(const SphereMesh& mesh){
+    auto vpoints = mesh.get_vertex_property<Vec4>("v:point");
+    int n = (int) ids.size();
+    primitives.resize(n);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<n; ++i){
+        Primitive& primitive = primitives[i];
+        primitive.id = ids[bvh.primitives()[i]];
+        SphereMesh::Vertex v[3];
+        switch(primitive_type(primitive.id)){
+        case PRIMITIVE_SPHERE:
+            v[0] = mesh.vertex(SphereMesh::Sphere(primitive_element(primitive.id)));
+            primitive.count = 1;
+            break;
+        case PRIMITIVE_PILL:
+            for(int k=0; k<2; ++k) v[k] = mesh.vertex(SphereMesh::Edge(primitive_element(primitive.id)), k);
+            primitive.count = 2;
+            break;
+        default:
+            for(int k=0; k<3; ++k) v[k] = mesh.vertex(SphereMesh::Face(primitive_element(primitive.id)), k);
+            primitive.count = 3;
+        }
+        for(int k=0; k<primitive.count; ++k){
+            Vec4 s = vpoints[v[k]];
+            primitive.centers[k] = s.head<3>();
+            primitive.radii[k] = s(3);
+        }
+        primitive.has_planes = (primitive.count == 3) &&
+                internal::wedge_planes(primitive.centers, primitive.radii, primitive.normals, primitive.offsets);
+    }
+}
+
+Scalar SphereMeshDistance::primitive_distance(const Primitive& primitive, const Vec3& p, Vec3& normal) const{
+    switch(primitive.count){
+    case 1: return internal::sphere_distance(p, primitive.centers[0], primitive.radii[0], normal);
+    case 2: return internal::pill_distance(p, primitive.centers[0], primitive.radii[0], primitive.centers[1], primitive.radii[1], normal);
+    default: return internal::wedge_distance(p, primitive.centers, primitive.radii, primitive.normals, primitive.offsets,
+                                             primitive.has_planes, normal);
+    }
+}
+
+Scalar SphereMeshDistance::distance(const Vec3& p, Vec3& closest, int* primitive) const{
+    Scalar best = inf();
+    int best_primitive = -1;
+    Vec3 best_normal = Vec3::Zero();
+    if(!bvh.empty()){
+        ///--- box distances bound signed distances from below, nodes containing p can hold negative ones
+        auto pruned = [&](Scalar box_d2){
+            return box_d2 > 0 && (best <= 0 || box_d2 >= best*best);
+        };
+        const std::vector<BVH3::Node>& nodes = bvh.nodes();
+        std::vector<std::pair<Scalar,int>> stack;
+        stack.reserve(64);
+        stack.push_back(std::make_pair(nodes[0].box.squaredExteriorDistance(p), 0));
+        while(!stack.empty()){
+            std::pair<Scalar,int> top = stack.back();
+            stack.pop_back();
+            if(pruned(top.first)) continue;
+            const BVH3::Node& node = nodes[top.second];
+            if(node.is_leaf()){
+                for(int i=node.first; i<node.first+node.count; ++i){
+                    Vec3 normal;
+                    Scalar d = primitive_distance(primitives[i], p, normal);
+                    if(d < best){
+                        best = d;
+                        best_primitive = primitives[i].id;
+                        best_normal = normal;
+                    }
+                }
+                continue;
+            }
+            ///--- visit the closer child first
+            Scalar dl = nodes[node.first].box.squaredExteriorDistance(p);
+            Scalar dr = nodes[node.first+1].box.squaredExteriorDistance(p);
+            if(dl < dr){
+                stack.push_back(std::make_pair(dr, node.first+1));
+                stack.push_back(std::make_pair(dl, node.first));
+            } else {
+                stack.push_back(std::make_pair(dl, node.first));
+                stack.push_back(std::make_pair(dr, node.first+1));
+            }
+        }
+    }
+    closest = (best_primitive < 0) ? p : Vec3(p - best*best_normal);
+    if(primitive) *primitive = best_primitive;
+    return best;
+}
+
+void SphereMeshDistance::distance(const Mat3xN& points, VecN& distances, Mat3xN& closest, std::vector<int>& closest_primitives) const{
+    int n = (int) points.cols();
+    distances.resize(n);
+    closest.resize(3, n);
+    closest_primitives.resize(n);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<n; ++i){
+        Vec3 q;
+        distances[i] = distance(Vec3(points.col(i)), q, &closest_primitives[i]);
+        closest.col(i) = q;
+    }
+}
+
+void SphereMeshDistance::voxelize(const Box3& box, const Eigen::Vector3i& res, const BrickCallback& emit, Scalar band, int brick_size) const{
+    internal::VoxelBricks bricks(box, res, brick_size);
+    bricks.for_each([&](int, const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Vec3& mid, Scalar radius, Scalar* values){
+        ///--- no sample of the brick can be within the band
+        Vec3 q;
+        Scalar d_mid = distance(mid, q);
+        if(std::abs(d_mid) > band + radius){
+            std::fill(values, values + size.prod(), (d_mid < 0) ? -band : band);
+            return;
+        }
+
+        ///--- samples provably outside the band (from the last query) are clamped without a query
+        Scalar last_d = d_mid;
+        Vec3 last_p = mid;
+        int k = 0;
+        for(int z=0; z<size.z(); ++z)
+            for(int y=0; y<size.y(); ++y)
+                for(int x=0; x<size.x(); ++x, ++k){
+                    Vec3 p = bricks.center(origin.x()+x, origin.y()+y, origin.z()+z);
+                    if(std::abs(last_d) - (p-last_p).norm() > band){
+                        values[k] = (last_d < 0) ? -band : band;
+                        continue;
+                    }
+                    last_d = distance(p, q);
+                    last_p = p;
+                    values[k] = std::max(-band, std::min(band, last_d));
+                }
+    }, emit);
+}
+
+SphereMeshDistance::PrimitiveType SphereMeshDistance::primitive_type(int primitive) const{
+    CHECK(primitive >= 0 && primitive < n_spheres + n_edges + n_faces);
+    if(primitive < n_spheres) return PRIMITIVE_SPHERE;
+    if(primitive < n_spheres + n_edges) return PRIMITIVE_PILL;
+    return PRIMITIVE_WEDGE;
+}
+
+int SphereMeshDistance::primitive_element(int primitive) const{
+    switch(primitive_type(primitive)){
+    case PRIMITIVE_SPHERE: return primitive;
+    case PRIMITIVE_PILL: return primitive - n_spheres;
+    default: return primitive - n_spheres - n_edges;
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
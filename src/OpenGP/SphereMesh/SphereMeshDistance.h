@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SphereMesh/SphereMesh.h>
+#include <OpenGP/util/BVH3.h>
+#include <OpenGP/util/VoxelBricks.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Signed distance of \c p to the sphere (center, radius) \c s, \c normal receives the outward unit gradient
+HEADERONLY_INLINE Scalar sphere_distance(const Vec3& p, const Vec4& s, Vec3& normal);
+/// Signed distance of \c p to a pill, the convex hull of two spheres (a round cone)
+HEADERONLY_INLINE Scalar pill_distance(const Vec3& p, const Vec4& s0, const Vec4& s1, Vec3& normal);
+/// Signed distance of \c p to a wedge, the convex hull of three spheres
+HEADERONLY_INLINE Scalar wedge_distance(const Vec3& p, const Vec4& s0, const Vec4& s1, const Vec4& s2, Vec3& normal);
+
+/// Batched closest point queries on the primitives of a SphereMesh: its spheres,
+/// pills (edges) and wedges (faces). Distances are exact outside; inside they
+/// are the depth within the deepest primitive (negative). Construction builds a
+/// BVH over the primitives and precomputes the tangent planes of the wedges,
+/// update() refreshes them after the model deformed. Primitives are identified by
+/// sphere index, then n_spheres + edge index, then n_spheres + n_edges + face index;
+/// deleted spheres, edges and faces are left out.
+class SphereMeshDistance{
+public:
+    enum PrimitiveType{ PRIMITIVE_SPHERE, PRIMITIVE_PILL, PRIMITIVE_WEDGE };
+
+    HEADERONLY_INLINE SphereMeshDistance(const SphereMesh& mesh);
+
+    /// New positions and radii of the same model (same spheres, edges and faces):
+    /// refits the BVH, rebuilds it if it degraded (see BVH3::update()) or if elements
+    /// were deleted since. True if rebuilt.
+    HEADERONLY_INLINE bool update(const SphereMesh& mesh, Scalar max_degradation=2);
+
+    /// signed distance of \c p to the model, closest point on its surface and closest primitive (-1 if there is none)
+    HEADERONLY_INLINE Scalar distance(const Vec3& p, Vec3& closest, int* primitive=nullptr) const;
+    /// queries for the columns of \c points, in parallel
+    HEADERONLY_INLINE void distance(const Mat3xN& points, VecN& distances, Mat3xN& closest, std::vector<int>& closest_primitives) const;
+
+    /// Samples the signed distance of the union of the primitives at the voxel centers
+    /// of \c box split in \c resolution voxels, brick by brick in parallel (see
+    /// SignedDistance::voxelize). Values are clamped to [-band, band]; a brick whose
+    /// center lies farther than band + its radius from the surface is filled from that
+    /// single query, the distance being 1-Lipschitz inside as well as outside.
+    HEADERONLY_INLINE void voxelize(const Box3& box, const Eigen::Vector3i& resolution, const BrickCallback& emit,
+                                    Scalar band=inf(), int brick_size=8) const;
+
+    HEADERONLY_INLINE PrimitiveType primitive_type(int primitive) const;
+    /// index of the sphere, edge or face of a primitive
+    HEADERONLY_INLINE int primitive_element(int primitive) const;
+
+private:
+    struct Primitive{
+        Vec3 centers[3];    ///< Vec3/Scalar instead of Vec4: no alignment requirement in std::vector
+        Scalar radii[3];
+        Vec3 normals[2];    ///< wedges: tangent planes n.x = offset, on the positive and negative side of the centers
+        Scalar offsets[2];
+        int id;
+        int count;          ///< number of spheres
+        bool has_planes;
+    };
+    /// ids of the primitives that are not deleted and their boxes, the input of the BVH
+    HEADERONLY_INLINE void live_primitives(const SphereMesh& mesh, std::vector<int>& ids, std::vector<Box3>& boxes) const;
+    /// geometry of the primitives, in BVH leaf order
+    HEADERONLY_INLINE void load_primitives(const SphereMesh& mesh);
+    HEADERONLY_INLINE Scalar primitive_distance(const Primitive& primitive, const Vec3& p, Vec3& normal) const;
+
+private:
+    int n_spheres, n_edges, n_faces;
+    BVH3 bvh;
+    std::vector<int> ids;              ///< primitive ids of the BVH entries
+    std::vector<Primitive> primitives; ///< in BVH leaf order
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "SphereMeshDistance.cpp"
+#endif
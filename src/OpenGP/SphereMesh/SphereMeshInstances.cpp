@@ -0,0 +1,143 @@
+#include "SphereMeshInstances.h"
+#include <OpenGP/SphereMesh/helpers.h>
+#include <Eigen/Geometry>
+#include <cmath>
+#include <cstring>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+inline void clear_instance(SphereMeshInstance& instance){
+    std::memset(&instance, 0, sizeof(SphereMeshInstance));
+}
+
+inline void store_vec3(float* dst, const Vec3& v){
+    dst[0] = v(0); dst[1] = v(1); dst[2] = v(2); dst[3] = 0;
+}
+
+inline void sphere_instance(const Vec4& s, SphereMeshInstance& instance){
+    clear_instance(instance);
+    Eigen::Map<Mat4x4> M(instance.model);
+    M.diagonal() << s(3), s(3), s(3), 1;
+    M.block<3,1>(0,3) = s.head<3>();
+    instance.ratio = 1;
+}
+
+/// Unit cone (radius 1 at z=0 to \c ratio at z=1) tangent to both spheres
+inline void cone_instance(const Vec4& s0, const Vec4& s1, SphereMeshInstance& instance){
+    clear_instance(instance);
+    Vec3 p0 = s0.head<3>(), p1 = s1.head<3>();
+    Scalar r0 = s0(3), r1 = s1(3);
+    Scalar length = (p1 - p0).norm();
+    if(!(length > std::abs(r1 - r0)) || !(r0 > 0)) return;
+    Vec3 axis = (p1 - p0) / length;
+
+    Vec2 tangent = pill_tangent(s0, s1);
+    Scalar beta = tangent(0), alpha = tangent(1);
+    Scalar height = length - alpha * std::abs(r1 - r0);
+    Vec3 offset = ((r1 > r0) ? -alpha : alpha) * r0 * axis;
+
+    ///--- FromTwoVectors also handles axes (anti)parallel to z
+    Mat3x3 R = Eigen::Quaternion<Scalar>::FromTwoVectors(Vec3(0,0,1), axis).toRotationMatrix();
+    Eigen::Map<Mat4x4> M(instance.model);
+    M.block<3,3>(0,0) = R * Vec3(r0 * beta, r0 * beta, height).asDiagonal();
+    M.block<3,1>(0,3) = p0 + offset;
+    M(3,3) = 1;
+    instance.ratio = r1 / r0;
+    instance.nrotate = std::atan2(beta * (r1 - r0), height);
+}
+
+/// The two triangles spanned by the tangent points of the planes touching the three spheres
+inline void triangle_instances(const Vec4& s0, const Vec4& s1, const Vec4& s2, SphereMeshInstance* instances){
+    clear_instance(instances[0]);
+    clear_instance(instances[1]);
+    Vec3 p0 = s0.head<3>(), p1 = s1.head<3>(), p2 = s2.head<3>();
+    Vec3 sn = (p2 - p0).cross(p1 - p0);
+    Scalar l1 = (p1 - p0).norm(), l2 = (p2 - p0).norm();
+    if(!(sn.norm() > 0) || !(l1 > std::abs(s1(3) - s0(3))) || !(l2 > std::abs(s2(3) - s0(3)))) return;
+    sn.normalize();
+
+    Vec2 ta = pill_tangent(s0, s1);
+    Vec2 tb = pill_tangent(s0, s2);
+    for(int side=0; side<2; ++side){
+        Scalar sign = side ? 1 : -1;
+        Vec3 tangent_a = ta(0) * (p1 - p0) / l1 + sign * ta(1) * sn;
+        Vec3 tangent_b = tb(0) * (p2 - p0) / l2 + sign * tb(1) * sn;
+        Vec3 tn = side ? tangent_b.cross(tangent_a) : tangent_a.cross(tangent_b);
+        if(!(tn.norm() > 0)) continue;
+        tn.normalize();
+        SphereMeshInstance& instance = instances[side];
+        Eigen::Map<Mat4x4>(instance.model).setIdentity();
+        instance.ratio = 1;
+        instance.vweight = 1;
+        store_vec3(instance.v0, p0 + s0(3) * tn);
+        store_vec3(instance.v1, p1 + s1(3) * tn);
+        store_vec3(instance.v2, p2 + s2(3) * tn);
+        store_vec3(instance.vn, tn);
+    }
+}
+
+} // internal
+
+void sphere_mesh_instances(const SphereMesh& mesh, SphereMeshInstances& instances){
+    auto vpoints = mesh.get_vertex_property<Vec4>("v:point");
+    int ns = mesh.spheres_size(), ne = mesh.edges_size(), nf = mesh.faces_size();
+
+    ///--- deleted elements are skipped, every vertex is drawn once however many primitives share it
+    std::vector<int> used(mesh.vertices_size(), 0);
+    std::vector<int> edges, faces;
+    edges.reserve(ne);
+    faces.reserve(nf);
+    for(int i=0; i<ns; ++i)
+        if(!mesh.is_deleted(SphereMesh::Sphere(i))) used[mesh.vertex(SphereMesh::Sphere(i)).idx()] = 1;
+    for(int i=0; i<ne; ++i){
+        if(mesh.is_deleted(SphereMesh::Edge(i))) continue;
+        edges.push_back(i);
+        for(int k=0; k<2; ++k) used[mesh.vertex(SphereMesh::Edge(i), k).idx()] = 1;
+    }
+    for(int i=0; i<nf; ++i){
+        if(mesh.is_deleted(SphereMesh::Face(i))) continue;
+        faces.push_back(i);
+        for(int k=0; k<3; ++k) used[mesh.vertex(SphereMesh::Face(i), k).idx()] = 1;
+    }
+    std::vector<int> sphere_vertices;
+    sphere_vertices.reserve(used.size());
+    for(int vi=0; vi<(int) used.size(); ++vi)
+        if(used[vi]) sphere_vertices.push_back(vi);
+
+    int nv = sphere_vertices.size();
+    int n_edges = edges.size(), n_faces = faces.size();
+    instances.spheres.resize(nv);
+    instances.cones.resize(n_edges + 3*n_faces);
+    instances.triangles.resize(2*n_faces);
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static) nowait
+        for(int i=0; i<nv; ++i)
+            internal::sphere_instance(vpoints[SphereMesh::Vertex(sphere_vertices[i])], instances.spheres[i]);
+
+        #pragma omp for schedule(static) nowait
+        for(int i=0; i<n_edges; ++i){
+            SphereMesh::Edge e(edges[i]);
+            internal::cone_instance(vpoints[mesh.vertex(e, 0)], vpoints[mesh.vertex(e, 1)], instances.cones[i]);
+        }
+
+        #pragma omp for schedule(static) nowait
+        for(int i=0; i<n_faces; ++i){
+            SphereMesh::Face f(faces[i]);
+            Vec4 s[3];
+            for(int k=0; k<3; ++k) s[k] = vpoints[mesh.vertex(f, k)];
+            for(int k=0; k<3; ++k)
+                internal::cone_instance(s[k], s[(k+1)%3], instances.cones[n_edges + 3*i + k]);
+            internal::triangle_instances(s[0], s[1], s[2], &instances.triangles[2*i]);
+        }
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SphereMesh/SphereMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Per-instance data of the unit sphere, cone and triangle drawn for a SphereMesh
+/// (see SphereMeshRendererFlat), packed as plain floats so that a vector of them
+/// can be uploaded as is and read as vec4 vertex attributes.
+struct SphereMeshInstance{
+    float model[16];  ///< column major transform of the unit geometry
+    float ratio;      ///< cones: top over bottom radius
+    float nrotate;    ///< cones: rotation of the normals towards the axis
+    float vweight;    ///< triangles: 1 to place the corners at v0, v1, v2
+    float pad;
+    float v0[4], v1[4], v2[4]; ///< triangles: tangent points (xyz)
+    float vn[4];               ///< triangles: normal (xyz)
+};
+
+/// Instances of one SphereMesh, in the order spheres, cones, triangles
+struct SphereMeshInstances{
+    std::vector<SphereMeshInstance> spheres;   ///< one per vertex used by a sphere, edge or face
+    std::vector<SphereMeshInstance> cones;     ///< one per edge, then three per face (deleted ones skipped)
+    std::vector<SphereMeshInstance> triangles; ///< two per face, the tangent planes on either side
+};
+
+/// Computes all instances of \c mesh in one parallel pass, in model coordinates.
+/// Instances of degenerate primitives (coincident spheres, a sphere containing the
+/// other, collinear face centers) are collapsed to zero size, those primitives are
+/// covered by their spheres. Needs no OpenGL context.
+HEADERONLY_INLINE void sphere_mesh_instances(const SphereMesh& mesh, SphereMeshInstances& instances);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "SphereMeshInstances.cpp"
+#endif
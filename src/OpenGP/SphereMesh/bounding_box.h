@@ -20,6 +20,39 @@ inline Box3 bounding_box(const SphereMesh& mesh) {
     return bbox;
 }
 
+/// Boxes of the primitives: spheres, then pills (edges), then wedges (faces), in
+/// index order (the primitive ids of SphereMeshDistance), e.g. for BVH3. Deleted
+/// elements get an empty box.
+inline void primitive_boxes(const SphereMesh& mesh, std::vector<Box3>& boxes) {
+    auto vpoints = mesh.get_vertex_property<Vec4>("v:point");
+    int ns = mesh.spheres_size(), ne = mesh.edges_size(), nf = mesh.faces_size();
+    boxes.resize(ns + ne + nf);
+    auto sphere_box = [&](SphereMesh::Vertex v) {
+        Vec4 point = vpoints[v];
+        Vec3 r = Vec3::Constant(point(3));
+        return Box3(point.head<3>() - r, point.head<3>() + r);
+    };
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int i = 0; i < ns + ne + nf; ++i) {
+        if (i < ns) {
+            SphereMesh::Sphere s(i);
+            if (mesh.is_deleted(s)) { boxes[i].setEmpty(); continue; }
+            boxes[i] = sphere_box(mesh.vertex(s));
+        } else if (i < ns + ne) {
+            SphereMesh::Edge e(i - ns);
+            if (mesh.is_deleted(e)) { boxes[i].setEmpty(); continue; }
+            boxes[i] = sphere_box(mesh.vertex(e, 0));
+            boxes[i].extend(sphere_box(mesh.vertex(e, 1)));
+        } else {
+            SphereMesh::Face f(i - ns - ne);
+            if (mesh.is_deleted(f)) { boxes[i].setEmpty(); continue; }
+            boxes[i] = sphere_box(mesh.vertex(f, 0));
+            boxes[i].extend(sphere_box(mesh.vertex(f, 1)));
+            boxes[i].extend(sphere_box(mesh.vertex(f, 2)));
+        }
+    }
+}
+
 //=============================================================================
 } // namespace OpenGP
 //=============================================================================
@@ -0,0 +1,37 @@
+#include "tessellate.h"
+#include <OpenGP/MLogger.h>
+#include <OpenGP/SphereMesh/SphereMeshDistance.h>
+#include <OpenGP/SphereMesh/bounding_box.h>
+#include <OpenGP/SurfaceMesh/MarchingCubes.h>
+#include <OpenGP/util/SparseGrid3.h>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+SurfaceMesh tessellate(const SphereMesh& mesh, int resolution){
+    CHECK(resolution > 0);
+    Box3 bbox = bounding_box(mesh);
+    if(bbox.isEmpty()) return SurfaceMesh();
+
+    ///--- cubic voxels, two of padding on each side
+    Scalar h = bbox.diagonal().maxCoeff() / resolution;
+    Box3 box(bbox.min() - Vec3::Constant(2*h), bbox.max() + Vec3::Constant(2*h));
+    Eigen::Vector3i res = (box.diagonal() / h).array().ceil().cast<int>().max(1);
+    box.max() = box.min() + h * res.cast<Scalar>();
+
+    ///--- marching cubes only reads the samples next to the surface; small bricks
+    /// as the band is a few voxels wide
+    Scalar band = 2*h;
+    SparseGrid3 grid(box, res, band, 4);
+    SphereMeshDistance distance(mesh);
+    distance.voxelize(box, res, [&](const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Scalar* values){
+        grid.insert(origin, size, values);
+    }, band, grid.brick_size());
+    return marching_cubes(grid);
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,24 @@
+#pragma once
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SphereMesh/SphereMesh.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Watertight triangle mesh of the union of the spheres, pills and wedges of \c mesh:
+/// its signed distance (SphereMeshDistance) is sampled in a narrow band on a sparse
+/// grid of \c resolution voxels along the longest side of the bounding box, then
+/// triangulated by marching cubes. The grid is padded so the surface never touches
+/// its boundary, features smaller than a voxel are lost.
+HEADERONLY_INLINE SurfaceMesh tessellate(const SphereMesh& mesh, int resolution=64);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "tessellate.cpp"
+#endif
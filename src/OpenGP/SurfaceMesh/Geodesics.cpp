@@ -0,0 +1,134 @@
+#include "Geodesics.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+HeatGeodesics::HeatGeodesics(const SurfaceMesh& mesh, Scalar time_factor) : mesh(mesh){
+    CHECK(mesh.is_triangle_mesh());
+    SurfaceMeshLaplacian op(mesh);
+    op.laplacian(L);
+    op.mass(M);
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+
+    double sum = 0;
+    for(auto e: mesh.edges())
+        sum += (vpoints[mesh.vertex(e,0)] - vpoints[mesh.vertex(e,1)]).norm();
+    mean_edge2 = (mesh.n_edges()>0) ? std::pow(sum/mesh.n_edges(), 2) : 1;
+
+    ///--- per face: corners, area, gradients of the hat functions
+    int nf = mesh.n_faces();
+    corners.resize(3*nf);
+    gradients.resize(3*nf);
+    areas.resize(nf);
+    #pragma omp parallel for
+    for(int fi=0; fi<nf; ++fi){
+        int k = 0;
+        for(auto v: mesh.vertices(SurfaceMesh::Face(fi)))
+            corners[3*fi+(k++)] = v.idx();
+        Eigen::Vector3d p[3];
+        for(int k=0; k<3; ++k)
+            p[k] = vpoints[SurfaceMesh::Vertex(corners[3*fi+k])].cast<double>();
+        Eigen::Vector3d N = (p[1]-p[0]).cross(p[2]-p[0]);
+        double A2 = N.norm();
+        areas[fi] = A2/2;
+        for(int k=0; k<3; ++k){
+            ///--- rotated opposite edge over twice the area
+            Eigen::Vector3d e = p[(k+2)%3] - p[(k+1)%3];
+            gradients[3*fi+k] = (A2 > 0) ? Eigen::Vector3d(N.cross(e)/(A2*A2)) : Eigen::Vector3d::Zero();
+        }
+    }
+
+    ///--- corners around each vertex (counting sort)
+    int n = mesh.n_vertices();
+    vcorners_begin.assign(n+1, 0);
+    for(int c=0; c<3*nf; ++c)
+        ++vcorners_begin[corners[c]+1];
+    for(int v=0; v<n; ++v)
+        vcorners_begin[v+1] += vcorners_begin[v];
+    vcorners.resize(3*nf);
+    std::vector<int> fill(vcorners_begin.begin(), vcorners_begin.end()-1);
+    for(int c=0; c<3*nf; ++c)
+        vcorners[fill[corners[c]]++] = c;
+
+    ///--- Poisson system, slightly regularized: -L is singular (constants)
+    double eps = 1e-10 * (-L.diagonal().sum()) / std::max(M.diagonal().sum(), 1e-300);
+    CHECK(poisson.compute(SparseMatrixd(-L + eps*M)));
+    set_time_factor(time_factor);
+}
+
+void HeatGeodesics::set_time_factor(Scalar time_factor){
+    double t = time_factor * mean_edge2;
+    CHECK(heat.compute(SparseMatrixd(M - t*L)));
+}
+
+void HeatGeodesics::compute(const std::vector<SurfaceMesh::Vertex>& sources, VecN& distances) const{
+    MatMxN D;
+    compute(std::vector<std::vector<SurfaceMesh::Vertex>>(1, sources), D);
+    distances = D.col(0);
+}
+
+void HeatGeodesics::compute(const std::vector<std::vector<SurfaceMesh::Vertex>>& sources, MatMxN& distances) const{
+    int n = mesh.n_vertices();
+    int k = (int) sources.size();
+    distances.resize(n, k);
+    const int block = 64; ///< columns sharing a gather pass
+    const int group = 8;  ///< columns per back-substitution
+
+    for(int c0=0; c0<k; c0+=block){
+        int m = std::min(block, k-c0);
+
+        ///--- heat flow from the sources, back-substitutions on groups of columns in parallel
+        Eigen::MatrixXd u(n, m);
+        #pragma omp parallel for schedule(dynamic)
+        for(int j0=0; j0<m; j0+=group){
+            int g = std::min(group, m-j0);
+            Eigen::MatrixXd delta = Eigen::MatrixXd::Zero(n, g);
+            for(int j=0; j<g; ++j)
+                for(auto v: sources[c0+j0+j])
+                    delta(v.idx(), j) = 1;
+            u.middleCols(j0, g) = heat.solve(delta);
+        }
+
+        ///--- least squares fit of grad(phi) to X = -grad(u)/|grad(u)|: -L phi = sum A grad(hat).X,
+        /// gathered per vertex from its faces
+        Eigen::MatrixXd b(n, m);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int vi=0; vi<n; ++vi){
+            for(int j=0; j<m; ++j){
+                double rhs = 0;
+                for(int i=vcorners_begin[vi]; i<vcorners_begin[vi+1]; ++i){
+                    int c = vcorners[i], f = c/3;
+                    Eigen::Vector3d g = u(corners[3*f], j)*gradients[3*f]
+                                      + u(corners[3*f+1], j)*gradients[3*f+1]
+                                      + u(corners[3*f+2], j)*gradients[3*f+2];
+                    double norm = g.norm();
+                    if(norm > 0)
+                        rhs -= areas[f] * gradients[c].dot(g) / norm;
+                }
+                b(vi, j) = rhs;
+            }
+        }
+
+        ///--- distances, shifted to vanish at the sources
+        #pragma omp parallel for schedule(dynamic)
+        for(int j0=0; j0<m; j0+=group){
+            int g = std::min(group, m-j0);
+            Eigen::MatrixXd phi = poisson.solve(b.middleCols(j0, g));
+            for(int j=0; j<g; ++j){
+                double shift = inf();
+                for(auto v: sources[c0+j0+j])
+                    shift = std::min(shift, phi(v.idx(), j));
+                if(sources[c0+j0+j].empty()) shift = 0;
+                distances.col(c0+j0+j) = (phi.col(j).array() - shift).cast<Scalar>().matrix();
+            }
+        }
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/SurfaceMesh/Laplacian.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Geodesic distances on a connected triangle mesh with the heat method (Crane et
+/// al. '13): heat diffused from the sources for a short time t, normalized
+/// gradient field, Poisson problem. Both systems, (M - tL) and -L, are factorized
+/// at construction; each query then costs back-substitutions and a parallel
+/// gradient/divergence pass. Keep the object while the mesh does not change.
+class HeatGeodesics{
+public:
+    /// t = time_factor * (mean edge length)^2, larger values give smoother distances
+    HEADERONLY_INLINE HeatGeodesics(const SurfaceMesh& mesh, Scalar time_factor=1);
+
+    /// refactorizes the heat system only (numerically, the symbolic analysis is reused)
+    HEADERONLY_INLINE void set_time_factor(Scalar time_factor);
+
+    /// distance of every vertex to the closest of the \c sources
+    HEADERONLY_INLINE void compute(const std::vector<SurfaceMesh::Vertex>& sources, VecN& distances) const;
+    /// batched queries, column j of \c distances holds the distances to sources[j].
+    /// Right hand sides are back-substituted in parallel, in blocks that share the gather pass.
+    HEADERONLY_INLINE void compute(const std::vector<std::vector<SurfaceMesh::Vertex>>& sources, MatMxN& distances) const;
+
+private:
+    const SurfaceMesh& mesh;
+    SparseMatrixd L, M;
+    CachedLDLT heat, poisson;
+    double mean_edge2;
+    std::vector<int> corners;               ///< 3 vertices per face
+    std::vector<Eigen::Vector3d> gradients; ///< 3 per face: gradient of the hat function of each corner
+    std::vector<double> areas;
+    std::vector<int> vcorners_begin, vcorners; ///< corners (3*face + k) around each vertex
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "Geodesics.cpp"
+#endif
@@ -0,0 +1,229 @@
+#include "Laplacian.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+SurfaceMeshLaplacian::SurfaceMeshLaplacian(const SurfaceMesh& mesh) : mesh(mesh){
+    CHECK(mesh.n_vertices()==mesh.vertices_size() && mesh.n_edges()==mesh.edges_size() && mesh.n_faces()==mesh.faces_size());
+    int n = mesh.n_vertices();
+
+    ///--- column v holds v and its neighbors, sorted
+    outer.assign(n+1, 0);
+    for(auto v: mesh.vertices())
+        outer[v.idx()+1] = mesh.valence(v) + 1;
+    for(int v=0; v<n; ++v)
+        outer[v+1] += outer[v];
+    inner.resize(outer[n]);
+    hentry.assign(mesh.halfedges_size(), -1);
+    ventry.resize(n);
+
+    #pragma omp parallel
+    {
+        std::vector<std::pair<int,int>> column; ///< (row, outgoing halfedge or -1)
+        #pragma omp for schedule(dynamic, 256)
+        for(int vi=0; vi<n; ++vi){
+            SurfaceMesh::Vertex v(vi);
+            column.clear();
+            column.push_back(std::make_pair(vi, -1));
+            for(auto h: mesh.halfedges(v))
+                column.push_back(std::make_pair(mesh.to_vertex(h).idx(), h.idx()));
+            std::sort(column.begin(), column.end());
+            for(size_t k=0; k<column.size(); ++k){
+                int e = outer[vi] + (int) k;
+                inner[e] = column[k].first;
+                if(column[k].second<0) ventry[vi] = e;
+                else hentry[column[k].second] = e;
+            }
+        }
+    }
+}
+
+void SurfaceMeshLaplacian::pattern(SparseMatrixd& A) const{
+    int n = (int) outer.size()-1;
+    A.resize(n, n);
+    A.resizeNonZeros((int) inner.size());
+    std::copy(outer.begin(), outer.end(), A.outerIndexPtr());
+    std::copy(inner.begin(), inner.end(), A.innerIndexPtr());
+    std::fill(A.valuePtr(), A.valuePtr()+inner.size(), 0.0);
+}
+
+void SurfaceMeshLaplacian::laplacian(SparseMatrixd& L, LaplacianType type) const{
+    CHECK(type==LAPLACIAN_UNIFORM || mesh.is_triangle_mesh());
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    pattern(L);
+    double* values = L.valuePtr();
+
+    /// cotangent of the angle at the corner opposite to h, 0 on the boundary
+    auto cotan = [&](SurfaceMesh::Halfedge h){
+        if(mesh.is_boundary(h)) return 0.0;
+        Eigen::Vector3d a = vpoints[mesh.from_vertex(h)].cast<double>();
+        Eigen::Vector3d b = vpoints[mesh.to_vertex(h)].cast<double>();
+        Eigen::Vector3d o = vpoints[mesh.to_vertex(mesh.next_halfedge(h))].cast<double>();
+        Eigen::Vector3d u = a-o, w = b-o;
+        double sin = u.cross(w).norm();
+        return (sin > 0) ? u.dot(w)/sin : 0.0;
+    };
+
+    int n = (int) ventry.size();
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int vi=0; vi<n; ++vi){
+        double sum = 0;
+        for(auto h: mesh.halfedges(SurfaceMesh::Vertex(vi))){
+            double w = (type==LAPLACIAN_COTAN) ? (cotan(h) + cotan(mesh.opposite_halfedge(h)))/2 : 1.0;
+            values[hentry[h.idx()]] = w;
+            sum += w;
+        }
+        values[ventry[vi]] = -sum;
+    }
+}
+
+void SurfaceMeshLaplacian::mass(SparseMatrixd& M, MassType type) const{
+    CHECK(mesh.is_triangle_mesh());
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    int n = (int) ventry.size();
+    int nf = mesh.n_faces();
+
+    std::vector<double> areas(nf);
+    #pragma omp parallel for
+    for(int fi=0; fi<nf; ++fi){
+        SurfaceMesh::Halfedge h = mesh.halfedge(SurfaceMesh::Face(fi));
+        Eigen::Vector3d a = vpoints[mesh.from_vertex(h)].cast<double>();
+        Eigen::Vector3d b = vpoints[mesh.to_vertex(h)].cast<double>();
+        Eigen::Vector3d c = vpoints[mesh.to_vertex(mesh.next_halfedge(h))].cast<double>();
+        areas[fi] = (b-a).cross(c-a).norm()/2;
+    }
+    auto area = [&](SurfaceMesh::Halfedge h){
+        return mesh.is_boundary(h) ? 0.0 : areas[mesh.face(h).idx()];
+    };
+
+    if(type==MASS_LUMPED){
+        ///--- diagonal pattern
+        M.resize(n, n);
+        M.resizeNonZeros(n);
+        for(int i=0; i<n; ++i){
+            M.outerIndexPtr()[i] = i;
+            M.innerIndexPtr()[i] = i;
+        }
+        M.outerIndexPtr()[n] = n;
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int vi=0; vi<n; ++vi){
+            double sum = 0;
+            for(auto h: mesh.halfedges(SurfaceMesh::Vertex(vi)))
+                sum += area(h);
+            M.valuePtr()[vi] = sum/3;
+        }
+        return;
+    }
+
+    pattern(M);
+    double* values = M.valuePtr();
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int vi=0; vi<n; ++vi){
+        double sum = 0;
+        for(auto h: mesh.halfedges(SurfaceMesh::Vertex(vi))){
+            values[hentry[h.idx()]] = (area(h) + area(mesh.opposite_halfedge(h)))/12;
+            sum += area(h);
+        }
+        values[ventry[vi]] = sum/6;
+    }
+}
+
+//=============================================================================
+
+bool CachedLDLT::compute(const SparseMatrixd& A){
+    ///--- FNV-1a over the dimensions and index arrays
+    size_t hash = 14695981039346656037ull;
+    auto mix = [&](int x){
+        hash ^= (size_t) (unsigned int) x;
+        hash *= 1099511628211ull;
+    };
+    CHECK(A.isCompressed());
+    mix(A.rows());
+    mix(A.cols());
+    for(int i=0; i<=A.outerSize(); ++i) mix(A.outerIndexPtr()[i]);
+    for(int i=0; i<A.nonZeros(); ++i) mix(A.innerIndexPtr()[i]);
+
+    if(analyses==0 || hash!=key){
+        solver.analyzePattern(A);
+        key = hash;
+        ++analyses;
+    }
+    solver.factorize(A);
+    return solver.info() == Eigen::Success;
+}
+
+//=============================================================================
+
+void symmetric_multiply(const SparseMatrixd& A, const Eigen::MatrixXd& X, Eigen::MatrixXd& Y){
+    CHECK(A.isCompressed() && A.rows()==A.cols() && A.cols()==X.rows());
+    int n = (int) A.cols(), k = (int) X.cols();
+    Y.resize(n, k);
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* values = A.valuePtr();
+    #pragma omp parallel
+    {
+        std::vector<double> sums(k);
+        #pragma omp for schedule(dynamic, 1024)
+        for(int i=0; i<n; ++i){
+            std::fill(sums.begin(), sums.end(), 0.0);
+            for(int e=outer[i]; e<outer[i+1]; ++e)
+                for(int j=0; j<k; ++j)
+                    sums[j] += values[e] * X(inner[e], j);
+            for(int j=0; j<k; ++j)
+                Y(i, j) = sums[j];
+        }
+    }
+}
+
+int pcg_solve(const SparseMatrixd& A, const Eigen::MatrixXd& B, Eigen::MatrixXd& X, double tolerance, int max_iterations){
+    int n = (int) A.rows(), k = (int) B.cols();
+    CHECK(X.rows()==n && X.cols()==k);
+    Eigen::VectorXd inv_diagonal = A.diagonal();
+    for(int i=0; i<n; ++i)
+        inv_diagonal[i] = (inv_diagonal[i] != 0) ? 1/inv_diagonal[i] : 1;
+
+    Eigen::MatrixXd R, Z(n, k), P, Q;
+    symmetric_multiply(A, X, Q);
+    R = B - Q;
+    Eigen::VectorXd rz(k), threshold(k);
+    std::vector<bool> active(k);
+    for(int j=0; j<k; ++j){
+        Z.col(j) = inv_diagonal.cwiseProduct(R.col(j));
+        rz[j] = R.col(j).dot(Z.col(j));
+        ///--- relative to the initial residual for homogeneous systems
+        threshold[j] = tolerance * std::max(B.col(j).norm(), R.col(j).norm());
+        active[j] = R.col(j).norm() > threshold[j];
+    }
+    P = Z;
+
+    int iteration = 0;
+    for(; iteration<max_iterations; ++iteration){
+        bool any = false;
+        for(int j=0; j<k; ++j) any = any || active[j];
+        if(!any) break;
+        symmetric_multiply(A, P, Q);
+        for(int j=0; j<k; ++j){
+            if(!active[j]) continue;
+            double pq = P.col(j).dot(Q.col(j));
+            if(pq <= 0){ active[j] = false; continue; }
+            double alpha = rz[j] / pq;
+            X.col(j) += alpha * P.col(j);
+            R.col(j) -= alpha * Q.col(j);
+            if(R.col(j).norm() <= threshold[j]){ active[j] = false; continue; }
+            Z.col(j) = inv_diagonal.cwiseProduct(R.col(j));
+            double rz_new = R.col(j).dot(Z.col(j));
+            P.col(j) = Z.col(j) + (rz_new / rz[j]) * P.col(j);
+            rz[j] = rz_new;
+        }
+    }
+    return iteration;
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <Eigen/Sparse>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Operators are assembled in double precision: cotangent systems factorized in
+/// float lose most of their digits on fine meshes.
+typedef Eigen::SparseMatrix<double> SparseMatrixd;
+
+enum LaplacianType{
+    LAPLACIAN_COTAN,   ///< L(i,j) = (cot a_ij + cot b_ij)/2 over edges, needs triangles
+    LAPLACIAN_UNIFORM, ///< L(i,j) = 1 over edges (graph Laplacian)
+};
+
+enum MassType{
+    MASS_LUMPED,   ///< diagonal, a third of the incident triangle areas
+    MASS_GALERKIN, ///< linear FEM mass: A/6 on the diagonal, A/12 per edge, summed over triangles
+};
+
+/// Assembles Laplacian and mass matrices of a mesh without triplets: the sparsity
+/// pattern (diagonal plus one entry per edge and direction) is derived from the
+/// connectivity once, at construction, together with the position of the entry
+/// of each halfedge. Assembly then only fills values, one column per vertex in
+/// parallel, from the current "v:point". Laplacians have zero row sums and are
+/// negative semi-definite (L = -sum on the diagonal). Keep the object while the
+/// connectivity does not change, the mesh must not contain deleted elements.
+class SurfaceMeshLaplacian{
+public:
+    HEADERONLY_INLINE SurfaceMeshLaplacian(const SurfaceMesh& mesh);
+
+    HEADERONLY_INLINE void laplacian(SparseMatrixd& L, LaplacianType type=LAPLACIAN_COTAN) const;
+    HEADERONLY_INLINE void mass(SparseMatrixd& M, MassType type=MASS_LUMPED) const;
+
+    /// an all-zero matrix with the pattern of the operators (e.g. to assemble custom weights)
+    HEADERONLY_INLINE void pattern(SparseMatrixd& A) const;
+    /// position in A.valuePtr() of the entry (to_vertex(h), from_vertex(h)) of a matrix with pattern()
+    int entry(SurfaceMesh::Halfedge h) const { return hentry[h.idx()]; }
+    /// position in A.valuePtr() of the diagonal entry of \c v
+    int diagonal(SurfaceMesh::Vertex v) const { return ventry[v.idx()]; }
+
+private:
+    const SurfaceMesh& mesh;
+    std::vector<int> outer, inner; ///< compressed column pattern
+    std::vector<int> hentry, ventry;
+};
+
+/// Sparse LDLT solver that keeps its symbolic analysis (fill reducing ordering
+/// and elimination tree) while the sparsity pattern of the factorized matrices
+/// stays the same, e.g. when positions or weights change on a fixed mesh. The
+/// pattern is recognized by a hash of the index arrays.
+class CachedLDLT{
+public:
+    /// numeric factorization of \c A (symbolic only if its pattern changed), false on failure
+    HEADERONLY_INLINE bool compute(const SparseMatrixd& A);
+
+    /// solution of A x = b, one column per right hand side
+    template <class Rhs>
+    Eigen::MatrixXd solve(const Eigen::MatrixBase<Rhs>& b) const { return solver.solve(b); }
+
+    /// number of symbolic analyses done so far
+    int n_analyses() const { return analyses; }
+
+private:
+    Eigen::SimplicialLDLT<SparseMatrixd> solver;
+    size_t key = 0;
+    int analyses = 0;
+};
+
+/// Y = A X for a symmetric \c A, rows in parallel (row i is gathered from column i)
+HEADERONLY_INLINE void symmetric_multiply(const SparseMatrixd& A, const Eigen::MatrixXd& X, Eigen::MatrixXd& Y);
+
+/// Solves A X = B for a symmetric positive definite \c A with Jacobi preconditioned
+/// conjugate gradients, starting from the given \c X (warm start). All columns are
+/// iterated together, sharing each product with \c A; a column stops once its
+/// residual is below tolerance*|b| (or
+/// tolerance times its initial residual, if larger). Returns the number of iterations.
+HEADERONLY_INLINE int pcg_solve(const SparseMatrixd& A, const Eigen::MatrixXd& B, Eigen::MatrixXd& X,
+                                double tolerance=1e-6, int max_iterations=1000);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "Laplacian.cpp"
+#endif
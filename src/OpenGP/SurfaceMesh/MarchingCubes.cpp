@@ -0,0 +1,258 @@
+#include "MarchingCubes.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// Triangles of the 256 cube cases. Corner k sits at (k&1, k>>1&1, k>>2&1), a
+/// corner is set when its sample is below the iso value. The table is derived
+/// from the faces rather than spelled out: on each face, an edge entering the
+/// set region is joined to the next edge leaving it (counter-clockwise seen from
+/// outside), the joined segments form loops that are fan triangulated. The fan
+/// apex is chosen so that no diagonal joins two edges of one cube face: the cube
+/// across that face could create the same diagonal, making it non-manifold.
+struct MarchingCubesTable{
+    int edge_corner[12]; ///< lower corner of each cube edge
+    int edge_axis[12];
+    std::vector<int> begin; ///< triangles of case c: edges[begin[c], begin[c+1])
+    std::vector<int> edges;
+
+    MarchingCubesTable(){
+        for(int axis=0, e=0; axis<3; ++axis)
+            for(int c=0; c<8; ++c)
+                if(!(c & (1<<axis))){
+                    edge_corner[e] = c;
+                    edge_axis[e] = axis;
+                    ++e;
+                }
+        auto edge_of = [&](int u, int w){
+            for(int e=0; e<12; ++e)
+                if(edge_corner[e]==std::min(u,w) && (1<<edge_axis[e])==(u^w)) return e;
+            return -1;
+        };
+        ///--- corners counter-clockwise seen from outside: x=0, x=1, y=0, y=1, z=0, z=1
+        const int faces[6][4] = {{0,4,6,2}, {1,3,7,5}, {0,1,5,4}, {2,6,7,3}, {0,2,3,1}, {4,5,7,6}};
+        int edge_faces[12] = {0}; ///< bit mask of the two faces of each edge
+        for(int f=0; f<6; ++f)
+            for(int j=0; j<4; ++j)
+                edge_faces[edge_of(faces[f][j], faces[f][(j+1)%4])] |= 1<<f;
+
+        begin.push_back(0);
+        for(int cube=0; cube<256; ++cube){
+            int next[12];
+            std::fill(next, next+12, -1);
+            for(int f=0; f<6; ++f){
+                bool in[4];
+                int e[4];
+                for(int j=0; j<4; ++j){
+                    in[j] = (cube >> faces[f][j]) & 1;
+                    e[j] = edge_of(faces[f][j], faces[f][(j+1)%4]);
+                }
+                for(int j=0; j<4; ++j){
+                    if(in[j] || !in[(j+1)%4]) continue;
+                    for(int d=1; d<4; ++d){
+                        int k = (j+d)%4;
+                        if(in[k] && !in[(k+1)%4]){ next[e[j]] = e[k]; break; }
+                    }
+                }
+            }
+            bool used[12] = {false};
+            std::vector<int> loop;
+            for(int start=0; start<12; ++start){
+                if(next[start]<0 || used[start]) continue;
+                loop.clear();
+                for(int e=start; !used[e]; e=next[e]){
+                    used[e] = true;
+                    loop.push_back(e);
+                }
+                int n = (int) loop.size();
+                int apex = 0;
+                for(int r=0; r<n; ++r){
+                    bool valid = true;
+                    for(int i=2; i<n-1; ++i)
+                        valid = valid && !(edge_faces[loop[r]] & edge_faces[loop[(r+i)%n]]);
+                    if(valid){ apex = r; break; }
+                }
+                for(int i=1; i+1<n; ++i){
+                    edges.push_back(loop[apex]);
+                    edges.push_back(loop[(apex+i)%n]);
+                    edges.push_back(loop[(apex+i+1)%n]);
+                }
+            }
+            begin.push_back((int) edges.size());
+        }
+    }
+};
+
+inline const MarchingCubesTable& marching_cubes_table(){
+    static const MarchingCubesTable table;
+    return table;
+}
+
+/// Marching cubes over the bricks listed in \c active, in parallel. A brick owns the
+/// grid edges whose lower sample it contains: the vertex on such an edge is created
+/// once, by its owner, and found by neighbors through the owner's edge table
+/// (no position hashing). Triangles reference edges by (neighbor, edge) until the
+/// per-brick vertex counts are known, the mesh is then assembled with build_triangles().
+template <class Sample>
+SurfaceMesh marching_cubes_bricks(const Box3& box, const Eigen::Vector3i& res, int B, const std::vector<int>& active,
+                                  Scalar iso, const Sample& sample){
+    const MarchingCubesTable& T = marching_cubes_table();
+    const unsigned short none = 0xFFFF;
+    CHECK(3*B*B*B < none);
+    const int S = B+1; ///< samples per brick, including the first layer of the upper neighbors
+    const int stride[3] = {1, S, S*S};
+    int corner_offset[8];
+    for(int c=0; c<8; ++c)
+        corner_offset[c] = (c&1)*stride[0] + ((c>>1)&1)*stride[1] + ((c>>2)&1)*stride[2];
+
+    Eigen::Vector3i nb = (res.array() + B-1) / B;
+    Vec3 h = box.diagonal().cwiseQuotient(res.cast<Scalar>());
+    int n_active = (int) active.size();
+    std::vector<int> slot(nb.prod(), -1);
+    for(int i=0; i<n_active; ++i)
+        slot[active[i]] = i;
+
+    struct Brick{
+        std::vector<unsigned short> table; ///< vertex of each owned edge (3 per sample)
+        std::vector<Vec3> points;
+        std::vector<int> refs;             ///< triangle corners, (neighbor << 16) | edge
+    };
+    std::vector<Brick> bricks(n_active);
+
+    #pragma omp parallel
+    {
+        std::vector<Scalar> L(S*S*S);
+        std::vector<unsigned short> table(3*B*B*B);
+        #pragma omp for schedule(dynamic)
+        for(int i=0; i<n_active; ++i){
+            int b = active[i];
+            Eigen::Vector3i origin = B * Eigen::Vector3i(b % nb.x(), (b / nb.x()) % nb.y(), b / (nb.x()*nb.y()));
+            Eigen::Vector3i n = (res - origin).cwiseMin(Eigen::Vector3i::Constant(S));
+            bool below = false, above = false;
+            for(int z=0; z<n.z(); ++z)
+                for(int y=0; y<n.y(); ++y)
+                    for(int x=0; x<n.x(); ++x){
+                        Scalar v = sample(origin.x()+x, origin.y()+y, origin.z()+z);
+                        L[x + S*(y + S*z)] = v;
+                        (v < iso ? below : above) = true;
+                    }
+            if(!below || !above) continue;
+            Brick& brick = bricks[i];
+
+            ///--- vertices on the owned edges
+            std::fill(table.begin(), table.end(), none);
+            Eigen::Vector3i m = n.cwiseMin(Eigen::Vector3i::Constant(B));
+            int nv = 0;
+            for(int z=0; z<m.z(); ++z)
+                for(int y=0; y<m.y(); ++y)
+                    for(int x=0; x<m.x(); ++x){
+                        int l = x + S*(y + S*z);
+                        bool in = L[l] < iso;
+                        int c[3] = {x, y, z};
+                        for(int axis=0; axis<3; ++axis){
+                            if(c[axis]+1 >= n[axis]) continue;
+                            Scalar v1 = L[l + stride[axis]];
+                            if((v1 < iso) == in) continue;
+                            Vec3 p = box.min() + h.cwiseProduct(Vec3(origin.x()+x+0.5f, origin.y()+y+0.5f, origin.z()+z+0.5f));
+                            p[axis] += (iso - L[l]) / (v1 - L[l]) * h[axis];
+                            table[((z*B + y)*B + x)*3 + axis] = (unsigned short) (nv++);
+                            brick.points.push_back(p);
+                        }
+                    }
+            if(nv > 0)
+                brick.table.assign(table.begin(), table.end());
+
+            ///--- triangles of the cells with their lower corner in the brick
+            for(int z=0; z<n.z()-1; ++z)
+                for(int y=0; y<n.y()-1; ++y)
+                    for(int x=0; x<n.x()-1; ++x){
+                        int l = x + S*(y + S*z);
+                        int cube = 0;
+                        for(int c=0; c<8; ++c)
+                            cube |= int(L[l + corner_offset[c]] < iso) << c;
+                        for(int k=T.begin[cube]; k<T.begin[cube+1]; ++k){
+                            int e = T.edges[k];
+                            int a = T.edge_corner[e];
+                            int ex = x + (a&1), ey = y + ((a>>1)&1), ez = z + ((a>>2)&1);
+                            int code = int(ex>=B) | int(ey>=B)<<1 | int(ez>=B)<<2;
+                            if(ex>=B) ex -= B;
+                            if(ey>=B) ey -= B;
+                            if(ez>=B) ez -= B;
+                            brick.refs.push_back((code << 16) | (((ez*B + ey)*B + ex)*3 + T.edge_axis[e]));
+                        }
+                    }
+        }
+    }
+
+    ///--- global numbering, then resolve the edge references
+    std::vector<int> voffset(n_active+1, 0), toffset(n_active+1, 0);
+    for(int i=0; i<n_active; ++i){
+        voffset[i+1] = voffset[i] + (int) bricks[i].points.size();
+        toffset[i+1] = toffset[i] + (int) bricks[i].refs.size();
+    }
+    std::vector<Vec3> points(voffset[n_active]);
+    std::vector<int> triangles(toffset[n_active]);
+    #pragma omp parallel for schedule(dynamic)
+    for(int i=0; i<n_active; ++i){
+        const Brick& brick = bricks[i];
+        std::copy(brick.points.begin(), brick.points.end(), points.begin() + voffset[i]);
+        for(size_t k=0; k<brick.refs.size(); ++k){
+            int code = brick.refs[k] >> 16;
+            int s = slot[active[i] + (code&1) + ((code>>1)&1)*nb.x() + ((code>>2)&1)*nb.x()*nb.y()];
+            triangles[toffset[i]+k] = voffset[s] + bricks[s].table[brick.refs[k] & 0xFFFF];
+        }
+    }
+    std::vector<Brick>().swap(bricks);
+
+    SurfaceMesh mesh;
+    mesh.build_triangles(points, triangles);
+    return mesh;
+}
+
+} // internal
+
+SurfaceMesh marching_cubes(const Box3& box, const Eigen::Vector3i& res, const std::vector<Scalar>& values, Scalar iso){
+    CHECK((int) values.size() == res.prod());
+    const int B = 8;
+    Eigen::Vector3i nb = (res.array() + B-1) / B;
+    std::vector<int> active(nb.prod());
+    for(int b=0; b<nb.prod(); ++b)
+        active[b] = b;
+    const int nx = res.x(), ny = res.y();
+    return internal::marching_cubes_bricks(box, res, B, active, iso, [&](int x, int y, int z){
+        return values[x + nx*(y + ny*z)];
+    });
+}
+
+SurfaceMesh marching_cubes(const SparseGrid3& grid, Scalar iso){
+    ///--- a cell can only cross the level set if its lower corner brick, or one of
+    /// the upper neighbors it reaches into, varies or lies on the other side
+    const Eigen::Vector3i& nb = grid.bricks();
+    std::vector<int> active;
+    for(int z=0; z<nb.z(); ++z)
+        for(int y=0; y<nb.y(); ++y)
+            for(int x=0; x<nb.x(); ++x){
+                int b = x + nb.x()*(y + nb.y()*z);
+                bool side = grid.brick_constant(b) < iso;
+                bool keep = !grid.is_constant(b);
+                for(int k=1; k<8 && !keep; ++k){
+                    int dx = k&1, dy = (k>>1)&1, dz = (k>>2)&1;
+                    if(x+dx >= nb.x() || y+dy >= nb.y() || z+dz >= nb.z()) continue;
+                    int n = b + dx + nb.x()*(dy + nb.y()*dz);
+                    keep = !grid.is_constant(n) || ((grid.brick_constant(n) < iso) != side);
+                }
+                if(keep) active.push_back(b);
+            }
+    return internal::marching_cubes_bricks(grid.box(), grid.resolution(), grid.brick_size(), active, iso, [&](int x, int y, int z){
+        return grid.value(x, y, z);
+    });
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/util/SparseGrid3.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Triangulates the \c iso level set of samples on a regular grid (marching cubes).
+/// Sample (x,y,z) lies at the center of voxel (x,y,z) of \c box split in \c resolution
+/// voxels and is read from values[x + nx*(y + ny*z)], the layout of SignedDistance::voxelize.
+/// Triangles face increasing values (outwards for a signed distance). Ambiguous cube
+/// faces always separate the samples below \c iso, so the output is watertight
+/// away from the grid boundary.
+HEADERONLY_INLINE SurfaceMesh marching_cubes(const Box3& box, const Eigen::Vector3i& resolution, const std::vector<Scalar>& values, Scalar iso=0);
+
+/// sparse version of marching_cubes(), constant bricks away from the level set are skipped
+HEADERONLY_INLINE SurfaceMesh marching_cubes(const SparseGrid3& grid, Scalar iso=0);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "MarchingCubes.cpp"
+#endif
@@ -0,0 +1,196 @@
+#include "RaycastDepthmap.h"
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+void SurfaceMeshRaycaster::init(){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+
+    ///--- fan triangulation
+    std::vector<Vec3> a, b, c;
+    std::vector<int> tri_face;
+    std::vector<Vec3> poly;
+    for(auto f: mesh.faces()){
+        poly.clear();
+        for(auto v: mesh.vertices(f))
+            poly.push_back(vpoints[v]);
+        for(size_t i=2; i<poly.size(); ++i){
+            a.push_back(poly[0]);
+            b.push_back(poly[i-1]);
+            c.push_back(poly[i]);
+            tri_face.push_back(f.idx());
+        }
+    }
+
+    int n = (int) a.size();
+    std::vector<Box3> boxes(n);
+    for(int i=0; i<n; ++i){
+        boxes[i].setEmpty();
+        boxes[i].extend(a[i]);
+        boxes[i].extend(b[i]);
+        boxes[i].extend(c[i]);
+    }
+    bvh.build(boxes);
+
+    ///--- store the triangles in leaf order for coherent access
+    const std::vector<int>& order = bvh.primitives();
+    v0.resize(n);
+    e1.resize(n);
+    e2.resize(n);
+    faces.resize(n);
+    for(int i=0; i<n; ++i){
+        int t = order[i];
+        v0[i] = a[t];
+        e1[i] = b[t]-a[t];
+        e2[i] = c[t]-a[t];
+        faces[i] = tri_face[t];
+    }
+}
+
+void SurfaceMeshRaycaster::intersect(RayPacket& R) const{
+    for(int i=0; i<R.n; ++i)
+        R.triangle[i] = -1;
+    if(bvh.empty() || R.n==0) return;
+
+    Scalar ix[RayPacket::SIZE], iy[RayPacket::SIZE], iz[RayPacket::SIZE];
+    for(int i=0; i<R.n; ++i){
+        ix[i] = 1/R.dx[i];
+        iy[i] = 1/R.dy[i];
+        iz[i] = 1/R.dz[i];
+    }
+
+    /// entry parameter of ray i into the box (inf() if it misses or hits after its current hit)
+    auto entry = [&](const Box3& box, int i){
+        Scalar tx0 = (box.min().x()-R.ox[i])*ix[i], tx1 = (box.max().x()-R.ox[i])*ix[i];
+        Scalar ty0 = (box.min().y()-R.oy[i])*iy[i], ty1 = (box.max().y()-R.oy[i])*iy[i];
+        Scalar tz0 = (box.min().z()-R.oz[i])*iz[i], tz1 = (box.max().z()-R.oz[i])*iz[i];
+        Scalar tnear = std::max(std::max(std::min(tx0,tx1), std::min(ty0,ty1)), std::max(std::min(tz0,tz1), Scalar(0)));
+        Scalar tfar = std::min(std::min(std::max(tx0,tx1), std::max(ty0,ty1)), std::min(std::max(tz0,tz1), R.t[i]));
+        return (tnear <= tfar) ? tnear : inf();
+    };
+    /// index of the first ray (from \c first) entering the box, R.n if none
+    auto first_hit = [&](const Box3& box, int first){
+        for(int i=first; i<R.n; ++i)
+            if(entry(box, i) < inf()) return i;
+        return R.n;
+    };
+
+    ///--- rays before the first active one missed an ancestor, they are skipped below it
+    const std::vector<BVH3::Node>& nodes = bvh.nodes();
+    std::vector<std::pair<int,int>> stack(1, std::make_pair(0,0));
+    while(!stack.empty()){
+        const BVH3::Node& node = nodes[stack.back().first];
+        int first = first_hit(node.box, stack.back().second);
+        stack.pop_back();
+        if(first==R.n) continue;
+        if(!node.is_leaf()){
+            ///--- front to back along the first active ray
+            int l = node.first, r = node.first+1;
+            if(entry(nodes[l].box, first) > entry(nodes[r].box, first)) std::swap(l, r);
+            stack.push_back(std::make_pair(r, first));
+            stack.push_back(std::make_pair(l, first));
+            continue;
+        }
+        for(int k=node.first; k<node.first+node.count; ++k){
+            const Vec3& a = v0[k];
+            const Vec3& u = e1[k];
+            const Vec3& v = e2[k];
+            ///--- Moller-Trumbore, one triangle against all rays
+            for(int i=first; i<R.n; ++i){
+                Scalar px = R.dy[i]*v.z() - R.dz[i]*v.y();
+                Scalar py = R.dz[i]*v.x() - R.dx[i]*v.z();
+                Scalar pz = R.dx[i]*v.y() - R.dy[i]*v.x();
+                Scalar det = u.x()*px + u.y()*py + u.z()*pz;
+                Scalar inv = 1/det;
+                Scalar sx = R.ox[i]-a.x(), sy = R.oy[i]-a.y(), sz = R.oz[i]-a.z();
+                Scalar b1 = (sx*px + sy*py + sz*pz)*inv;
+                Scalar qx = sy*u.z() - sz*u.y();
+                Scalar qy = sz*u.x() - sx*u.z();
+                Scalar qz = sx*u.y() - sy*u.x();
+                Scalar b2 = (R.dx[i]*qx + R.dy[i]*qy + R.dz[i]*qz)*inv;
+                Scalar t = (v.x()*qx + v.y()*qy + v.z()*qz)*inv;
+                bool hit = (det != 0) && (b1 >= 0) && (b2 >= 0) && (b1+b2 <= 1) && (t > 0) && (t < R.t[i]);
+                R.t[i] = hit ? t : R.t[i];
+                R.triangle[i] = hit ? k : R.triangle[i];
+            }
+        }
+    }
+}
+
+int SurfaceMeshRaycaster::intersect(const Vec3& o, const Vec3& d, Scalar& t) const{
+    RayPacket R;
+    R.n = 1;
+    R.ox[0] = o.x(); R.oy[0] = o.y(); R.oz[0] = o.z();
+    R.dx[0] = d.x(); R.dy[0] = d.y(); R.dz[0] = d.z();
+    R.t[0] = t;
+    intersect(R);
+    t = R.t[0];
+    return R.triangle[0];
+}
+
+//=============================================================================
+
+RaycastDepthmap::RaycastDepthmap(int width, int height) : width(width), height(height){
+    points.resize(3*width*height);
+    depth.resize(width*height);
+    clear();
+}
+
+void RaycastDepthmap::clear(){
+    std::fill(points.begin(), points.end(), 0.0f);
+    std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+void RaycastDepthmap::render(const SurfaceMeshRaycaster& scene, const Eigen::Matrix4f& M, const Eigen::Matrix4f& V, const Eigen::Matrix4f& P){
+    ///--- rays are cast in model space, from the near (t=0) to the far (t=1) plane
+    Eigen::Matrix4d MV = (V*M).cast<double>();
+    Eigen::Matrix4d Pd = P.cast<double>();
+    Eigen::Matrix4d unproject = (Pd*MV).inverse();
+
+    const int tile = 8;
+    int tiles_x = (width+tile-1)/tile;
+    int tiles_y = (height+tile-1)/tile;
+    #pragma omp parallel for schedule(dynamic)
+    for(int ti=0; ti<tiles_x*tiles_y; ++ti){
+        int x0 = (ti%tiles_x)*tile;
+        int y0 = (ti/tiles_x)*tile;
+        RayPacket R;
+        int pixel[RayPacket::SIZE];
+        for(int y=y0; y<std::min(y0+tile, height); ++y){
+            for(int x=x0; x<std::min(x0+tile, width); ++x){
+                double xn = 2.0*(x+0.5)/width - 1.0;
+                double yn = 2.0*(y+0.5)/height - 1.0;
+                Eigen::Vector4d n = unproject * Eigen::Vector4d(xn, yn, -1, 1);
+                Eigen::Vector4d f = unproject * Eigen::Vector4d(xn, yn, 1, 1);
+                Eigen::Vector3d o = n.head<3>()/n.w();
+                Eigen::Vector3d d = f.head<3>()/f.w() - o;
+                int i = R.n++;
+                R.ox[i] = o.x(); R.oy[i] = o.y(); R.oz[i] = o.z();
+                R.dx[i] = d.x(); R.dy[i] = d.y(); R.dz[i] = d.z();
+                R.t[i] = 1;
+                pixel[i] = y*width + x;
+            }
+        }
+        scene.intersect(R);
+
+        for(int i=0; i<R.n; ++i){
+            if(R.triangle[i]<0) continue;
+            Eigen::Vector4d p(R.ox[i] + R.t[i]*R.dx[i], R.oy[i] + R.t[i]*R.dy[i], R.oz[i] + R.t[i]*R.dz[i], 1);
+            Eigen::Vector4d view = MV*p;
+            Eigen::Vector4d clip = Pd*view;
+            float z = float(0.5*clip.z()/clip.w() + 0.5);
+            if(z >= depth[pixel[i]]) continue;
+            depth[pixel[i]] = z;
+            points[3*pixel[i]+0] = float(view.x());
+            points[3*pixel[i]+1] = float(view.y());
+            points[3*pixel[i]+2] = float(view.z());
+        }
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
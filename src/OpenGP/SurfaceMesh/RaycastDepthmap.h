@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/util/BVH3.h>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+/// A bundle of rays o + t*d in structure-of-arrays layout, traversed together
+/// (coherent primary rays visit nearly the same nodes, the per-ray loops vectorize)
+struct RayPacket{
+    static const int SIZE = 64;
+    int n = 0;                  ///< number of rays in use
+    Scalar ox[SIZE], oy[SIZE], oz[SIZE];
+    Scalar dx[SIZE], dy[SIZE], dz[SIZE];
+    Scalar t[SIZE];             ///< in: maximum parameter, out: parameter of the closest hit
+    int triangle[SIZE];         ///< out: closest triangle or -1
+};
+
+/// Triangles of a SurfaceMesh (polygons are fan triangulated) with a BVH, the CPU
+/// counterpart of SurfaceMeshDepthmapRenderer for RaycastDepthmap
+class SurfaceMeshRaycaster{
+public:
+    SurfaceMeshRaycaster(const SurfaceMesh& mesh) : mesh(mesh){}
+
+    /// (re)builds the BVH from the current "v:point", call after the mesh changed
+    HEADERONLY_INLINE void init();
+
+    /// closest hit of o + t*d with t in (0, t]: returns the triangle (or -1) and updates \c t
+    HEADERONLY_INLINE int intersect(const Vec3& o, const Vec3& d, Scalar& t) const;
+    /// closest hits of a packet of rays
+    HEADERONLY_INLINE void intersect(RayPacket& packet) const;
+
+    /// face the triangle returned by intersect() comes from
+    SurfaceMesh::Face face(int triangle) const { return SurfaceMesh::Face(faces[triangle]); }
+
+private:
+    const SurfaceMesh& mesh;
+    BVH3 bvh;
+    std::vector<Vec3> v0, e1, e2; ///< triangles in BVH leaf order
+    std::vector<int> faces;
+};
+
+/// Headless alternative to SyntheticDepthmap: same inputs (M, V, P, width, height)
+/// and same buffers, computed by casting one ray per pixel center. The points
+/// buffer stores the view space position (V*M*p) of the visible surface, or zero;
+/// the depth buffer stores the window depth in [0,1] (1 where nothing was hit).
+/// Rows start at the bottom of the image, as read back from an OpenGL texture.
+/// Pixels are processed in tiles of 8x8 rays, tiles in parallel.
+class RaycastDepthmap{
+private:
+    std::vector<float> points;
+    std::vector<float> depth;
+    int width, height;
+
+public:
+    HEADERONLY_INLINE RaycastDepthmap(int width, int height);
+
+    HEADERONLY_INLINE void clear();
+
+    /// renders \c scene, keeping the closest surface per pixel (like GL_LESS)
+    HEADERONLY_INLINE void render(const SurfaceMeshRaycaster& scene, const Eigen::Matrix4f& M, const Eigen::Matrix4f& V, const Eigen::Matrix4f& P);
+
+    /// 3 floats per pixel, see SyntheticDepthmap::cpu_data()
+    const float* cpu_data() const { return points.data(); }
+    /// 1 float per pixel
+    const float* depth_data() const { return depth.data(); }
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "RaycastDepthmap.cpp"
+#endif
@@ -0,0 +1,331 @@
+#include "SignedDistance.h"
+#include <OpenGP/SurfaceMesh/bounding_box.h>
+#include <OpenGP/MLogger.h>
+#include <OpenGP/util/VoxelBricks.h>
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+Scalar closest_point_triangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c, Vec3& closest, TriangleRegion* region){
+    auto done = [&](TriangleRegion r){
+        if(region) *region = r;
+        return (p - closest).squaredNorm();
+    };
+    // Check if P in vertex region outside A
+    Vec3 ab = b - a;
+    Vec3 ac = c - a;
+    Vec3 ap = p - a;
+    Scalar d1 = ab.dot(ap);
+    Scalar d2 = ac.dot(ap);
+    if (d1 <= 0 && d2 <= 0) {
+        closest = a;
+        return done(REGION_VERTEX_A); // barycentric coordinates (1,0,0)
+    }
+    // Check if P in vertex region outside B
+    Vec3 bp = p - b;
+    Scalar d3 = ab.dot(bp);
+    Scalar d4 = ac.dot(bp);
+    if (d3 >= 0 && d4 <= d3) {
+        closest = b;
+        return done(REGION_VERTEX_B); // barycentric coordinates (0,1,0)
+    }
+    // Check if P in edge region of AB, if so return projection of P onto AB
+    Scalar vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        Scalar v = d1 / (d1 - d3);
+        closest = a + v * ab;
+        return done(REGION_EDGE_AB); // barycentric coordinates (1-v,v,0)
+    }
+    // Check if P in vertex region outside C
+    Vec3 cp = p - c;
+    Scalar d5 = ab.dot(cp);
+    Scalar d6 = ac.dot(cp);
+    if (d6 >= 0 && d5 <= d6) {
+        closest = c;
+        return done(REGION_VERTEX_C); // barycentric coordinates (0,0,1)
+    }
+    // Check if P in edge region of AC, if so return projection of P onto AC
+    Scalar vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        Scalar w = d2 / (d2 - d6);
+        closest = a + w * ac;
+        return done(REGION_EDGE_CA); // barycentric coordinates (1-w,0,w)
+    }
+    // Check if P in edge region of BC, if so return projection of P onto BC
+    Scalar va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        Scalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        closest = b + w * (c - b);
+        return done(REGION_EDGE_BC); // barycentric coordinates (0,1-w,w)
+    }
+    // P inside face region. Compute Q through its barycentric coordinates (u,v,w)
+    Scalar denom = 1.0 / (va + vb + vc);
+    Scalar v = vb * denom;
+    Scalar w = vc * denom;
+    closest = a + ab * v + ac * w;
+    return done(REGION_FACE); // = u*a + v*b + w*c, u = va * denom = 1 - v - w
+}
+
+//=============================================================================
+
+SignedDistance::SignedDistance(const SurfaceMesh& mesh){
+    CHECK(mesh.is_triangle_mesh());
+    std::vector<Box3> boxes;
+    face_boxes(mesh, boxes);
+    bvh.build(boxes);
+    load_triangles(mesh);
+}
+
+bool SignedDistance::update(const SurfaceMesh& mesh, Scalar max_degradation){
+    CHECK(mesh.n_faces() == tri_faces.size());
+    std::vector<Box3> boxes;
+    face_boxes(mesh, boxes);
+    bool rebuilt = bvh.update(boxes, max_degradation);
+    load_triangles(mesh);
+    return rebuilt;
+}
+
+void SignedDistance::load_triangles(const SurfaceMesh& mesh){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+
+    ///--- face normals and the angle of each face at the target of its halfedges
+    int nf = mesh.faces_size();
+    std::vector<Vec3> fnormals(nf, Vec3::Zero());
+    std::vector<Scalar> hangles(mesh.halfedges_size(), 0);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int fi=0; fi<nf; ++fi){
+        SurfaceMesh::Face f(fi);
+        if(mesh.is_deleted(f)) continue;
+        SurfaceMesh::Halfedge h[3];
+        h[0] = mesh.halfedge(f);
+        h[1] = mesh.next_halfedge(h[0]);
+        h[2] = mesh.next_halfedge(h[1]);
+        Vec3 p[3];
+        for(int i=0; i<3; ++i)
+            p[i] = vpoints[mesh.to_vertex(h[i])];
+        Vec3 N = (p[1]-p[0]).cross(p[2]-p[0]);
+        Scalar double_area = N.norm();
+        if(!(double_area > 0) || !std::isfinite(double_area)) continue;
+        fnormals[fi] = N/double_area;
+        for(int i=0; i<3; ++i)
+            hangles[h[i].idx()] = std::atan2(double_area, (p[(i+1)%3]-p[i]).dot(p[(i+2)%3]-p[i]));
+    }
+
+    ///--- angle weighted vertex normals and edge normals (sum of the incident face normals), gathered
+    int nv = mesh.vertices_size(), ne = mesh.edges_size();
+    std::vector<Vec3> vnormals(nv, Vec3::Zero());
+    std::vector<Vec3> enormals(ne, Vec3::Zero());
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int vi=0; vi<nv; ++vi){
+        SurfaceMesh::Vertex v(vi);
+        if(mesh.is_deleted(v) || mesh.is_isolated(v)) continue;
+        for(auto h: mesh.halfedges(v)){
+            SurfaceMesh::Halfedge in = mesh.opposite_halfedge(h);
+            if(!mesh.is_boundary(in))
+                vnormals[vi] += hangles[in.idx()] * fnormals[mesh.face(in).idx()];
+        }
+    }
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int ei=0; ei<ne; ++ei){
+        SurfaceMesh::Edge e(ei);
+        if(mesh.is_deleted(e)) continue;
+        for(int k=0; k<2; ++k)
+            if(!mesh.is_boundary(mesh.halfedge(e, k)))
+                enormals[ei] += fnormals[mesh.face(mesh.halfedge(e, k)).idx()];
+    }
+
+    ///--- triangles (a,b,c) = (to(h), to(next(h)), to(next(next(h)))), in BVH order
+    std::vector<SurfaceMesh::Face> faces;
+    faces.reserve(mesh.n_faces());
+    for(auto f: mesh.faces())
+        faces.push_back(f);
+
+    int n = (int) faces.size();
+    tri_points.resize(3*n);
+    tri_faces.resize(n);
+    tri_normals.resize(7*n);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int i=0; i<n; ++i){
+        SurfaceMesh::Face f = faces[bvh.primitives()[i]];
+        SurfaceMesh::Halfedge h[3];
+        h[0] = mesh.halfedge(f);
+        h[1] = mesh.next_halfedge(h[0]);
+        h[2] = mesh.next_halfedge(h[1]);
+        for(int k=0; k<3; ++k)
+            tri_points[3*i+k] = vpoints[mesh.to_vertex(h[k])];
+        tri_faces[i] = f.idx();
+        Vec3* N = &tri_normals[7*i];
+        N[REGION_FACE] = (tri_points[3*i+1]-tri_points[3*i]).cross(tri_points[3*i+2]-tri_points[3*i]);
+        N[REGION_VERTEX_A] = vnormals[mesh.to_vertex(h[0]).idx()];
+        N[REGION_VERTEX_B] = vnormals[mesh.to_vertex(h[1]).idx()];
+        N[REGION_VERTEX_C] = vnormals[mesh.to_vertex(h[2]).idx()];
+        N[REGION_EDGE_AB] = enormals[mesh.edge(h[1]).idx()];
+        N[REGION_EDGE_BC] = enormals[mesh.edge(h[2]).idx()];
+        N[REGION_EDGE_CA] = enormals[mesh.edge(h[0]).idx()];
+    }
+}
+
+int SignedDistance::closest_triangle(const Vec3& p, Scalar& best_d2, Vec3& closest, TriangleRegion& region) const{
+    int best = -1;
+    if(bvh.empty()) return best;
+    const std::vector<BVH3::Node>& nodes = bvh.nodes();
+    std::vector<std::pair<Scalar,int>> stack;
+    stack.push_back(std::make_pair(nodes[0].box.squaredExteriorDistance(p), 0));
+    while(!stack.empty()){
+        std::pair<Scalar,int> top = stack.back();
+        stack.pop_back();
+        if(top.first >= best_d2) continue;
+        const BVH3::Node& node = nodes[top.second];
+        if(node.is_leaf()){
+            for(int i=node.first; i<node.first+node.count; ++i){
+                Vec3 q;
+                TriangleRegion r;
+                Scalar d2 = closest_point_triangle(p, tri_points[3*i], tri_points[3*i+1], tri_points[3*i+2], q, &r);
+                if(d2 < best_d2){
+                    best_d2 = d2;
+                    best = i;
+                    closest = q;
+                    region = r;
+                }
+            }
+            continue;
+        }
+        ///--- visit the closer child first
+        Scalar dl = nodes[node.first].box.squaredExteriorDistance(p);
+        Scalar dr = nodes[node.first+1].box.squaredExteriorDistance(p);
+        if(dl < dr){
+            stack.push_back(std::make_pair(dr, node.first+1));
+            stack.push_back(std::make_pair(dl, node.first));
+        } else {
+            stack.push_back(std::make_pair(dl, node.first));
+            stack.push_back(std::make_pair(dr, node.first+1));
+        }
+    }
+    return best;
+}
+
+Scalar SignedDistance::closest_point(const Vec3& p, Vec3& closest, SurfaceMesh::Face* face, Scalar max_distance) const{
+    Scalar d2 = (max_distance < inf()) ? max_distance*max_distance : inf();
+    TriangleRegion region;
+    int t = closest_triangle(p, d2, closest, region);
+    if(face) *face = (t<0) ? SurfaceMesh::Face() : SurfaceMesh::Face(tri_faces[t]);
+    return (t<0) ? inf() : std::sqrt(d2);
+}
+
+Scalar SignedDistance::signed_distance(const Vec3& p, Scalar max_distance) const{
+    Scalar d2 = (max_distance < inf()) ? max_distance*max_distance : inf();
+    Vec3 closest;
+    TriangleRegion region;
+    int t = closest_triangle(p, d2, closest, region);
+    if(t<0) return inf();
+    Scalar d = std::sqrt(d2);
+    return ((p-closest).dot(tri_normals[7*t+region]) < 0) ? -d : d;
+}
+
+void SignedDistance::signed_distance(const Mat3xN& points, VecN& distances) const{
+    int n = (int) points.cols();
+    distances.resize(n);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<n; ++i)
+        distances[i] = signed_distance(Vec3(points.col(i)));
+}
+
+void SignedDistance::voxelize(const Box3& box, const Eigen::Vector3i& res, const BrickCallback& emit, Scalar band, int brick_size) const{
+    internal::VoxelBricks bricks(box, res, brick_size);
+    Vec3 h = bricks.spacing();
+    Eigen::Vector3i n_bricks = bricks.bricks();
+    int n_total = bricks.size();
+
+    ///--- narrow band: bricks farther than the band from the surface are constant. Their sample
+    /// hulls grown by the band overlap those of face-adjacent bricks when band >= h/2: the surface
+    /// cannot pass between two far bricks, which then share their sign (one query per component).
+    /// Narrower bands leave a gap between the hulls, each far brick gets its own sign query.
+    std::vector<Scalar> far_value(n_total, 0); ///< 0 for bricks in the band
+    if(band < inf()){
+        std::vector<char> far(n_total, 0);
+        #pragma omp parallel for schedule(dynamic)
+        for(int bi=0; bi<n_total; ++bi){
+            Eigen::Vector3i origin, size;
+            Vec3 mid, q;
+            Scalar radius;
+            bricks.extent(bi, origin, size, mid, radius);
+            far[bi] = (closest_point(mid, q, nullptr, band + radius) == inf());
+        }
+        std::vector<int> parent(n_total);
+        for(int bi=0; bi<n_total; ++bi) parent[bi] = bi;
+        auto find = [&](int i){
+            while(parent[i]!=i){ parent[i] = parent[parent[i]]; i = parent[i]; }
+            return i;
+        };
+        bool merge = (band >= h.maxCoeff()/2);
+        for(int bi=0; bi<n_total && merge; ++bi){
+            if(!far[bi]) continue;
+            Eigen::Vector3i c = bricks.coords(bi);
+            if(c.x()+1 < n_bricks.x() && far[bi+1]) parent[find(bi)] = find(bi+1);
+            if(c.y()+1 < n_bricks.y() && far[bi+n_bricks.x()]) parent[find(bi)] = find(bi+n_bricks.x());
+            if(c.z()+1 < n_bricks.z() && far[bi+n_bricks.x()*n_bricks.y()]) parent[find(bi)] = find(bi+n_bricks.x()*n_bricks.y());
+        }
+        std::vector<int> roots;
+        for(int bi=0; bi<n_total; ++bi)
+            if(far[bi] && find(bi)==bi) roots.push_back(bi);
+        #pragma omp parallel for schedule(dynamic)
+        for(int r=0; r<(int)roots.size(); ++r){
+            Eigen::Vector3i origin, size;
+            Vec3 mid;
+            Scalar radius;
+            bricks.extent(roots[r], origin, size, mid, radius);
+            far_value[roots[r]] = (signed_distance(mid) < 0) ? -band : band;
+        }
+        for(int bi=0; bi<n_total; ++bi)
+            if(far[bi]) far_value[bi] = far_value[find(bi)];
+    }
+
+    bricks.for_each([&](int bi, const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Vec3& mid, Scalar, Scalar* values){
+        if(far_value[bi] != 0){
+            std::fill(values, values + size.prod(), far_value[bi]);
+            return;
+        }
+
+        ///--- 1-Lipschitz: |d(p)-d(q)| <= |p-q| bounds the next search. Clamped values
+        /// are lower bounds of |d| with the correct sign, which is all the bound needs.
+        Scalar prev_d = inf();
+        Vec3 prev_p = mid;
+        int k = 0;
+        for(int z=0; z<size.z(); ++z){
+            for(int y=0; y<size.y(); ++y){
+                for(int x=0; x<size.x(); ++x, ++k){
+                    Vec3 p = bricks.center(origin.x()+x, origin.y()+y, origin.z()+z);
+                    Scalar step = (p-prev_p).norm();
+                    Scalar bound = std::min(std::abs(prev_d) + step, band)*Scalar(1.0001) + Scalar(1e-12);
+                    Scalar d = signed_distance(p, bound);
+                    if(d == inf()){
+                        ///--- outside the band: the sign carries over unless the surface may lie in between
+                        if(prev_d < inf() && std::abs(prev_d) > step) d = (prev_d < 0) ? -band : band;
+                        else d = signed_distance(p);
+                    }
+                    d = std::max(-band, std::min(band, d));
+                    prev_d = d;
+                    prev_p = p;
+                    values[k] = d;
+                }
+            }
+        }
+    }, emit);
+}
+
+void SignedDistance::voxelize(const Box3& box, const Eigen::Vector3i& res, std::vector<Scalar>& sdf, Scalar band) const{
+    sdf.resize(size_t(res.x())*res.y()*res.z());
+    voxelize(box, res, [&](const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Scalar* values){
+        for(int z=0; z<size.z(); ++z)
+            for(int y=0; y<size.y(); ++y)
+                std::copy(values + size.x()*(y + size.y()*z), values + size.x()*(y + size.y()*z + 1),
+                          sdf.begin() + (origin.x() + size_t(res.x())*((origin.y()+y) + size_t(res.y())*(origin.z()+z))));
+    }, band);
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/util/BVH3.h>
+#include <OpenGP/util/VoxelBricks.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Voronoi region of a triangle (a,b,c) containing the closest point
+enum TriangleRegion{
+    REGION_FACE = 0,
+    REGION_VERTEX_A, REGION_VERTEX_B, REGION_VERTEX_C,
+    REGION_EDGE_AB, REGION_EDGE_BC, REGION_EDGE_CA,
+};
+
+/// Closest point to \c p on the triangle (a,b,c), returns the squared distance
+/// (Ericson, Real-Time Collision Detection, 5.1.5)
+HEADERONLY_INLINE Scalar closest_point_triangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c,
+                                                Vec3& closest, TriangleRegion* region=nullptr);
+
+/// Closest point and signed distance queries on a triangle mesh. The sign comes
+/// from angle weighted pseudo-normals (Baerentzen & Aanaes '05): it is exact for
+/// closed, consistently oriented meshes, negative inside. Construction builds a
+/// BVH over the current positions: call update() after the vertices moved, rebuild
+/// the object after the connectivity changed.
+class SignedDistance{
+public:
+    HEADERONLY_INLINE SignedDistance(const SurfaceMesh& mesh);
+
+    /// New positions of the same mesh: refits the BVH, rebuilds it if it degraded
+    /// (see BVH3::update()), recomputes triangles and pseudo-normals. True if rebuilt.
+    HEADERONLY_INLINE bool update(const SurfaceMesh& mesh, Scalar max_degradation=2);
+
+    /// closest point on the mesh (\c face receives its face), returns the unsigned distance.
+    /// \c max_distance bounds the search: farther points report inf() without a face.
+    HEADERONLY_INLINE Scalar closest_point(const Vec3& p, Vec3& closest, SurfaceMesh::Face* face=nullptr, Scalar max_distance=inf()) const;
+    /// signed distance of \c p (negative inside), see closest_point() for \c max_distance
+    HEADERONLY_INLINE Scalar signed_distance(const Vec3& p, Scalar max_distance=inf()) const;
+    /// signed distances of the columns of \c points, in parallel
+    HEADERONLY_INLINE void signed_distance(const Mat3xN& points, VecN& distances) const;
+
+    /// Samples the signed distance on a grid of \c resolution voxels spanning \c box
+    /// (voxel centers), brick by brick in parallel, streaming each brick to \c emit.
+    /// Distances are clamped to [-band, band]: bricks farther than \c band from the
+    /// surface are filled without per-voxel queries. Queries inside a brick reuse the
+    /// previous result to bound the BVH search.
+    HEADERONLY_INLINE void voxelize(const Box3& box, const Eigen::Vector3i& resolution, const BrickCallback& emit,
+                                    Scalar band=inf(), int brick_size=8) const;
+    /// dense version of voxelize(), \c sdf is indexed x + nx*(y + ny*z)
+    HEADERONLY_INLINE void voxelize(const Box3& box, const Eigen::Vector3i& resolution, std::vector<Scalar>& sdf,
+                                    Scalar band=inf()) const;
+
+private:
+    /// triangles and pseudo-normals, in BVH leaf order
+    HEADERONLY_INLINE void load_triangles(const SurfaceMesh& mesh);
+    /// closest triangle (in BVH order) to \c p among those closer than sqrt(best_d2)
+    HEADERONLY_INLINE int closest_triangle(const Vec3& p, Scalar& best_d2, Vec3& closest, TriangleRegion& region) const;
+
+private:
+    BVH3 bvh;
+    std::vector<Vec3> tri_points;  ///< 3 per triangle, in BVH leaf order
+    std::vector<int> tri_faces;
+    std::vector<Vec3> tri_normals; ///< 7 per triangle: face, vertices a,b,c, edges ab,bc,ca (TriangleRegion order)
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "SignedDistance.cpp"
+#endif
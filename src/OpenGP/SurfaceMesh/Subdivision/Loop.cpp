@@ -1,5 +1,285 @@
 #include "Loop.h"
 #include <OpenGP/MLogger.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+namespace internal {
+//=============================================================================
+
+/// A level of the array based refinement: a triangle soup plus crease tags
+struct LoopLevel{
+    std::vector<Vec3> points;
+    std::vector<int>  triangles; ///< 3 vertex indices per face, corner c is the halfedge triangles[c] -> head(c)
+    std::vector<char> vfeature;  ///< per vertex
+    std::vector<char> cfeature;  ///< per corner, tags the edge of the corner halfedge
+
+    int n_vertices() const { return (int) vfeature.size(); }
+    int n_corners() const { return (int) triangles.size(); }
+    static int next(int c) { return (c % 3 == 2) ? c - 2 : c + 1; }
+    static int prev(int c) { return (c % 3 == 0) ? c + 2 : c - 1; }
+    int tail(int c) const { return triangles[c]; }
+    int head(int c) const { return triangles[next(c)]; }
+};
+
+/// Edges and one-rings of a LoopLevel, stored in compressed sparse row layout
+struct LoopTopology{
+    std::vector<int>  out_begin, out; ///< outgoing corners per vertex
+    std::vector<int>  in_begin, in;   ///< incoming corners per vertex
+    std::vector<int>  opposite;       ///< opposite corner (-1 on the boundary)
+    std::vector<int>  edge;           ///< edge of every corner
+    std::vector<int>  edge_corner;    ///< owner corner of every edge
+    std::vector<char> efeature;       ///< per edge
+
+    int n_edges() const { return (int) edge_corner.size(); }
+
+    explicit LoopTopology(const LoopLevel& L){
+        const int nv = L.n_vertices();
+        const int nc = L.n_corners();
+
+        ///--- counting sort of the corners by tail and by head vertex
+        out_begin.assign(nv+1, 0);
+        in_begin.assign(nv+1, 0);
+        for(int c = 0; c < nc; c++){
+            out_begin[L.tail(c)+1]++;
+            in_begin[L.head(c)+1]++;
+        }
+        for(int v = 0; v < nv; v++){
+            out_begin[v+1] += out_begin[v];
+            in_begin[v+1] += in_begin[v];
+        }
+        out.resize(nc);
+        in.resize(nc);
+        std::vector<int> out_end(out_begin.begin(), out_begin.end()-1);
+        std::vector<int> in_end(in_begin.begin(), in_begin.end()-1);
+        for(int c = 0; c < nc; c++){
+            out[out_end[L.tail(c)]++] = c;
+            in[in_end[L.head(c)]++] = c;
+        }
+
+        ///--- opposite corners
+        opposite.assign(nc, -1);
+        #pragma omp parallel for
+        for(int c = 0; c < nc; c++){
+            const int a = L.tail(c), b = L.head(c);
+            for(int i = out_begin[b]; i < out_begin[b+1]; i++)
+                if(L.head(out[i]) == a){ opposite[c] = out[i]; break; }
+        }
+
+        ///--- edges are owned by the smaller of their two corners
+        edge.resize(nc);
+        edge_corner.clear();
+        edge_corner.reserve(nc/2 + nc/4);
+        for(int c = 0; c < nc; c++)
+            if(opposite[c] < 0 || c < opposite[c]){
+                edge[c] = (int) edge_corner.size();
+                edge_corner.push_back(c);
+            }
+        const int ne = n_edges();
+        efeature.assign(ne, 0);
+        #pragma omp parallel for
+        for(int c = 0; c < nc; c++){
+            if(opposite[c] >= 0 && c > opposite[c])
+                edge[c] = edge[opposite[c]];
+        }
+        #pragma omp parallel for
+        for(int e = 0; e < ne; e++){
+            const int c = edge_corner[e];
+            efeature[e] = L.cfeature[c] || (opposite[c] >= 0 && L.cfeature[opposite[c]]);
+        }
+    }
+
+    bool is_boundary_edge(int e) const { return opposite[edge_corner[e]] < 0; }
+};
+
+/// Loop rule for the refined position of vertex \c v, as a weighted sum emit(vertex, weight)
+template <class Emit>
+inline void loop_vertex_rule(const LoopLevel& L, const LoopTopology& T, int v, Emit emit){
+    const int ob = T.out_begin[v], oe = T.out_begin[v+1];
+    const int ib = T.in_begin[v], ie = T.in_begin[v+1];
+
+    ///--- isolated vertex?
+    if(ob == oe && ib == ie){
+        emit(v, Scalar(1));
+        return;
+    }
+
+    ///--- boundary vertex? (outgoing and incoming boundary corners)
+    int n0 = -1, n1 = -1;
+    for(int i = ob; i < oe; i++)
+        if(T.opposite[T.out[i]] < 0) n0 = L.head(T.out[i]);
+    for(int i = ib; i < ie; i++)
+        if(T.opposite[T.in[i]] < 0) n1 = L.tail(T.in[i]);
+    if(n0 >= 0 || n1 >= 0){
+        if(n0 < 0 || n1 < 0){ emit(v, Scalar(1)); return; } ///< corrupt boundary: keep fixed
+        emit(v, Scalar(0.75));
+        emit(n0, Scalar(0.125));
+        emit(n1, Scalar(0.125));
+        return;
+    }
+
+    ///--- interior feature vertex?
+    if(L.vfeature[v]){
+        int count = 0, f0 = -1, f1 = -1;
+        for(int i = ob; i < oe; i++){
+            if(T.efeature[T.edge[T.out[i]]]){
+                (count == 0 ? f0 : f1) = L.head(T.out[i]);
+                if(++count > 2) break;
+            }
+        }
+        if(count == 2){ ///< vertex is on feature edge
+            emit(v, Scalar(0.75));
+            emit(f0, Scalar(0.125));
+            emit(f1, Scalar(0.125));
+        } else { ///< keep fixed
+            emit(v, Scalar(1));
+        }
+        return;
+    }
+
+    ///--- interior vertex
+    Scalar inv_k = 1.0 / (oe - ob);
+    Scalar beta = (0.625 - std::pow(0.375 + 0.25*std::cos(2.0*M_PI*inv_k), 2.0));
+    emit(v, Scalar(1.0-beta));
+    for(int i = ob; i < oe; i++)
+        emit(L.head(T.out[i]), beta*inv_k);
+}
+
+/// Loop rule for the position of the vertex inserted on edge \c e
+template <class Emit>
+inline void loop_edge_rule(const LoopLevel& L, const LoopTopology& T, int e, Emit emit){
+    const int c0 = T.edge_corner[e];
+    const int c1 = T.opposite[c0];
+    if(c1 < 0 || T.efeature[e]){ ///< boundary or feature edge
+        emit(L.tail(c0), Scalar(0.5));
+        emit(L.head(c0), Scalar(0.5));
+    } else { ///< interior edge
+        emit(L.tail(c0), Scalar(0.375));
+        emit(L.head(c0), Scalar(0.375));
+        emit(L.triangles[LoopLevel::prev(c0)], Scalar(0.125));
+        emit(L.triangles[LoopLevel::prev(c1)], Scalar(0.125));
+    }
+}
+
+/// Topology of the next level: vertices [0,nv) are the old vertices, vertex nv+e
+/// sits on edge e, every face is split 1-to-4. Points are left empty.
+inline void loop_refine_topology(const LoopLevel& L, const LoopTopology& T, LoopLevel& R){
+    const int nv = L.n_vertices();
+    const int ne = T.n_edges();
+    const int nf = L.n_corners() / 3;
+
+    R.vfeature.resize(nv + ne);
+    std::copy(L.vfeature.begin(), L.vfeature.end(), R.vfeature.begin());
+    std::copy(T.efeature.begin(), T.efeature.end(), R.vfeature.begin() + nv);
+
+    R.triangles.resize(12*nf);
+    R.cfeature.resize(12*nf);
+    #pragma omp parallel for
+    for(int f = 0; f < nf; f++){
+        const int a = L.triangles[3*f], b = L.triangles[3*f+1], c = L.triangles[3*f+2];
+        const int m0 = nv + T.edge[3*f], m1 = nv + T.edge[3*f+1], m2 = nv + T.edge[3*f+2];
+        const char f0 = T.efeature[T.edge[3*f]], f1 = T.efeature[T.edge[3*f+1]], f2 = T.efeature[T.edge[3*f+2]];
+        const int tris[12]  = { a, m0, m2,   m0, b, m1,   m2, m1, c,   m0, m1, m2 };
+        const char feat[12] = { f0, 0, f2,   f0, f1, 0,   0, f1, f2,   0, 0, 0 };
+        std::copy(tris, tris+12, R.triangles.begin() + 12*f);
+        std::copy(feat, feat+12, R.cfeature.begin() + 12*f);
+    }
+}
+
+/// Flattens the topology and crease tags of \c mesh into \c L (points are left empty).
+/// Vertices are numbered in iteration order, i.e. deleted vertices are skipped.
+inline void loop_flatten(const SurfaceMesh& mesh, LoopLevel& L){
+    SurfaceMesh::Vertex_property<bool> vfeature = mesh.get_vertex_property<bool>("v:feature");
+    SurfaceMesh::Edge_property<bool>   efeature = mesh.get_edge_property<bool>("e:feature");
+
+    std::vector<int> vindex(mesh.vertices_size(), -1);
+    for(SurfaceMesh::Vertex v: mesh.vertices()){
+        vindex[v.idx()] = (int) L.vfeature.size();
+        L.vfeature.push_back(vfeature && vfeature[v]);
+    }
+    L.triangles.reserve(3*mesh.n_faces());
+    L.cfeature.reserve(3*mesh.n_faces());
+    for(SurfaceMesh::Face f: mesh.faces()){
+        for(SurfaceMesh::Halfedge h: mesh.halfedges(f)){
+            L.triangles.push_back(vindex[mesh.from_vertex(h).idx()]);
+            L.cfeature.push_back(efeature && efeature[mesh.edge(h)]);
+        }
+    }
+}
+
+//=============================================================================
+} // namespace internal
+} // namespace OpenGP
+//=============================================================================
+
+SurfaceMeshSubdivideLoop::Point SurfaceMeshSubdivideLoop::vertex_point(const OpenGP::SurfaceMesh& mesh, Vertex v, const VertexProperty<Point>& points,
+                                                                         const VertexProperty<bool>& vfeature, const EdgeProperty<bool>& efeature){
+    if ( /*isolated vertex?*/ mesh.is_isolated(v)){
+        return points[v];
+    }
+    else if (/*boundary vertex?*/ mesh.is_boundary(v) ) {
+        Halfedge h1 = mesh.halfedge(v);
+        Halfedge h0 = mesh.prev_halfedge(h1);
+        Point p = points[v];
+        p *= 6.0;
+        p += points[mesh.to_vertex(h1)];
+        p += points[mesh.from_vertex(h0)];
+        p *= 0.125;
+        return p;
+    }
+
+    // interior feature vertex?
+    else if (vfeature && vfeature[v]) {
+        Point p = points[v];
+        p *= 6.0;
+        int count = 0;
+
+        for(Halfedge vh: mesh.halfedges(v)){
+            if (efeature[mesh.edge(vh)]) {
+                p += points[mesh.to_vertex(vh)];
+                ++count;
+            }
+        }
+
+        if (count == 2) { // vertex is on feature edge
+            p *= 0.125;
+            return p;
+        } else { // keep fixed
+            return points[v];
+        }
+    }
+
+    // interior vertex
+    else {
+        Point p = Point::Zero();
+        Scalar  inv_k = 1.0 / mesh.valence(v);
+        for(Vertex vvit: mesh.vertices(v))
+            p += inv_k * points[vvit];
+        Scalar beta = (0.625 - pow(0.375 + 0.25*cos(2.0*M_PI*inv_k), 2.0));
+
+        return points[v]*(Scalar)(1.0-beta) + beta*p;
+    }
+}
+
+SurfaceMeshSubdivideLoop::Point SurfaceMeshSubdivideLoop::edge_point(const OpenGP::SurfaceMesh& mesh, Edge e, const VertexProperty<Point>& points,
+                                                                       const EdgeProperty<bool>& efeature){
+    if ( /*boundary or feature edge?*/ mesh.is_boundary(e) || (efeature && efeature[e])) {
+        return (points[mesh.vertex(e,0)] + points[mesh.vertex(e,1)]) * Scalar(0.5);
+    }
+    else /*interior edge*/ {
+        Halfedge h0 = mesh.halfedge(e, 0);
+        Halfedge h1 = mesh.halfedge(e, 1);
+        Point p = points[mesh.to_vertex(h0)];
+        p += points[mesh.to_vertex(h1)];
+        p *= 3.0;
+        p += points[mesh.to_vertex(mesh.next_halfedge(h0))];
+        p += points[mesh.to_vertex(mesh.next_halfedge(h1))];
+        p *= 0.125;
+        return p;
+    }
+}
 
 void SurfaceMeshSubdivideLoop::exec(OpenGP::SurfaceMesh& mesh){
     /// TODO: other pre-conditions?
@@ -19,71 +299,12 @@ void SurfaceMeshSubdivideLoop::exec(OpenGP::SurfaceMesh& mesh){
     EdgeProperty<bool>    efeature = mesh.get_edge_property<bool>("e:feature");
 
     // compute vertex positions
-    for(Vertex v: mesh.vertices()){
-        if ( /*isolated vertex?*/ mesh.is_isolated(v)){
-            vpoint[v] = points[v];
-        }
-        else if (/*boundary vertex?*/ mesh.is_boundary(v) ) {
-            Halfedge h1 = mesh.halfedge(v);
-            Halfedge h0 = mesh.prev_halfedge(h1);
-            Point p = points[v];
-            p *= 6.0;
-            p += points[mesh.to_vertex(h1)];
-            p += points[mesh.from_vertex(h0)];
-            p *= 0.125;
-            vpoint[v] = p;
-        }
-
-        // interior feature vertex?
-        else if (vfeature && vfeature[v]) {
-            Point p = points[v];
-            p *= 6.0;
-            int count = 0;
-
-            for(Halfedge vh: mesh.halfedges(v)){
-                if (efeature[mesh.edge(vh)]) {
-                    p += points[mesh.to_vertex(vh)];
-                    ++count;
-                }
-            }
-
-            if (count == 2) { // vertex is on feature edge
-                p *= 0.125;
-                vpoint[v] = p;
-            } else { // keep fixed
-                vpoint[v] = points[v];
-            }
-        }
-
-        // interior vertex
-        else {
-            Point p = Point::Zero();
-            Scalar  inv_k = 1.0 / mesh.valence(v);
-            for(Vertex vvit: mesh.vertices(v))
-                p += inv_k * points[vvit];
-            Scalar beta = (0.625 - pow(0.375 + 0.25*cos(2.0*M_PI*inv_k), 2.0));
-
-            vpoint[v] = points[v]*(Scalar)(1.0-beta) + beta*p;
-        }
-    }
+    for(Vertex v: mesh.vertices())
+        vpoint[v] = vertex_point(mesh, v, points, vfeature, efeature);
 
     // compute edge positions
-    for(Edge e: mesh.edges()){
-        if ( /*boundary or feature edge?*/ mesh.is_boundary(e) || (efeature && efeature[e])) {
-            epoint[e] = (points[mesh.vertex(e,0)] + points[mesh.vertex(e,1)]) * Scalar(0.5);
-        }
-        else /*interior edge*/ {
-            Halfedge h0 = mesh.halfedge(e, 0);
-            Halfedge h1 = mesh.halfedge(e, 1);
-            Point p = points[mesh.to_vertex(h0)];
-            p += points[mesh.to_vertex(h1)];
-            p *= 3.0;
-            p += points[mesh.to_vertex(mesh.next_halfedge(h0))];
-            p += points[mesh.to_vertex(mesh.next_halfedge(h1))];
-            p *= 0.125;
-            epoint[e] = p;
-        }
-    }
+    for(Edge e: mesh.edges())
+        epoint[e] = edge_point(mesh, e, points, efeature);
 
     // set new vertex positions
     for(Vertex v: mesh.vertices())
@@ -120,3 +341,279 @@ void SurfaceMeshSubdivideLoop::exec(OpenGP::SurfaceMesh& mesh){
     mesh.remove_vertex_property(vpoint);
     mesh.remove_edge_property(epoint);
 }
+
+void SurfaceMeshSubdivideLoop::exec(OpenGP::SurfaceMesh& mesh, int levels){
+    CHECK(mesh.is_triangle_mesh());
+
+    VertexProperty<Point> points = mesh.vertex_property<Point>("v:point");
+    VertexProperty<bool>  vfeature = mesh.get_vertex_property<bool>("v:feature");
+    EdgeProperty<bool>    efeature = mesh.get_edge_property<bool>("e:feature");
+
+    using namespace OpenGP::internal;
+
+    ///--- flatten the mesh (skipping deleted elements)
+    LoopLevel L;
+    loop_flatten(mesh, L);
+    for(Vertex v: mesh.vertices())
+        L.points.push_back(points[v]);
+
+    ///--- refine
+    for(int level = 0; level < levels; level++){
+        LoopTopology T(L);
+        LoopLevel R;
+        loop_refine_topology(L, T, R);
+
+        const int nv = L.n_vertices();
+        const int ne = T.n_edges();
+        R.points.resize(nv + ne);
+        #pragma omp parallel for
+        for(int v = 0; v < nv; v++){
+            Point p = Point::Zero();
+            loop_vertex_rule(L, T, v, [&](int i, Scalar w){ p += w * L.points[i]; });
+            R.points[v] = p;
+        }
+        #pragma omp parallel for
+        for(int e = 0; e < ne; e++){
+            Point p = Point::Zero();
+            loop_edge_rule(L, T, e, [&](int i, Scalar w){ p += w * L.points[i]; });
+            R.points[nv + e] = p;
+        }
+        std::swap(L, R);
+    }
+
+    ///--- rebuild connectivity in bulk
+    mesh.build_triangles(L.points, L.triangles);
+
+    ///--- carry over crease tags
+    if(vfeature){
+        vfeature = mesh.get_vertex_property<bool>("v:feature");
+        for(Vertex v: mesh.vertices())
+            vfeature[v] = L.vfeature[v.idx()];
+    }
+    if(efeature){
+        efeature = mesh.get_edge_property<bool>("e:feature");
+        for(Face f: mesh.faces()){
+            for(Halfedge h: mesh.halfedges(f)){
+                for(int c = 3*f.idx(); c < 3*f.idx()+3; c++)
+                    if(L.triangles[c] == mesh.from_vertex(h).idx())
+                        efeature[mesh.edge(h)] = L.cfeature[c];
+            }
+        }
+    }
+}
+
+void SurfaceMeshSubdivideLoop::exec(OpenGP::SurfaceMesh& mesh, const std::function<bool(Face)>& refine, int levels){
+    CHECK(mesh.is_triangle_mesh());
+
+    VertexProperty<Point> points = mesh.vertex_property<Point>("v:point");
+    VertexProperty<bool>  vfeature = mesh.get_vertex_property<bool>("v:feature");
+    EdgeProperty<bool>    efeature = mesh.get_edge_property<bool>("e:feature");
+
+    for(int level=0; level<levels; ++level){
+        FaceProperty<bool> fselected = mesh.get_face_property<bool>("f:selected");
+        FaceProperty<char> fred = mesh.add_face_property<char>("loop:fred", 0); ///< 1: selected, 2: closure
+        EdgeProperty<bool> esplit = mesh.add_edge_property<bool>("loop:esplit", false);
+
+        ///--- edges of the selected faces are split
+        std::vector<Face> queue;
+        auto split = [&](Edge e){
+            if(esplit[e]) return;
+            esplit[e] = true;
+            for(int i=0; i<2; ++i){
+                Face f = mesh.face(mesh.halfedge(e,i));
+                if(f.is_valid() && !fred[f]) queue.push_back(f);
+            }
+        };
+        int n_selected = 0;
+        for(Face f: mesh.faces()){
+            if(!refine(f)) continue;
+            fred[f] = 1;
+            ++n_selected;
+            for(Halfedge h: mesh.halfedges(f))
+                split(mesh.edge(h));
+        }
+        if(n_selected==0){
+            mesh.remove_face_property(fred);
+            mesh.remove_edge_property(esplit);
+            break;
+        }
+
+        ///--- red-green closure: faces with two or more split edges are refined too
+        while(!queue.empty()){
+            Face f = queue.back();
+            queue.pop_back();
+            if(fred[f]) continue;
+            int count = 0;
+            for(Halfedge h: mesh.halfedges(f))
+                count += esplit[mesh.edge(h)];
+            if(count<2) continue;
+            fred[f] = 2;
+            for(Halfedge h: mesh.halfedges(f))
+                split(mesh.edge(h));
+        }
+
+        ///--- edge points on the split edges, vertex rule only where every face is refined
+        EdgeProperty<Point> epoint = mesh.add_edge_property<Point>("loop:epoint");
+        VertexProperty<Point> vpoint = mesh.add_vertex_property<Point>("loop:vpoint");
+        for(Edge e: mesh.edges())
+            if(esplit[e]) epoint[e] = edge_point(mesh, e, points, efeature);
+        for(Vertex v: mesh.vertices()){
+            bool inside = !mesh.is_isolated(v);
+            for(Face f: mesh.faces(v))
+                if(!fred[f]) { inside = false; break; }
+            vpoint[v] = inside ? vertex_point(mesh, v, points, vfeature, efeature) : points[v];
+        }
+        for(Vertex v: mesh.vertices())
+            points[v] = vpoint[v];
+
+        ///--- inserts new vertices on the split edges
+        int nv = mesh.vertices_size();
+        for(Edge e: mesh.edges()){
+            if(!esplit[e]) continue;
+            Halfedge e_v = mesh.insert_vertex(e, epoint[e]);
+            if (efeature && efeature[e]) {
+                Vertex v = mesh.to_vertex(e_v);
+                Edge   e = *(--mesh.edges_end());
+                if(vfeature) vfeature[v] = true;
+                efeature[e] = true;
+            }
+        }
+
+        ///--- red faces are split in four, green faces (one split edge) are bisected
+        for(Face f: mesh.faces()){
+            Halfedge h; ///< must point to a new vertex
+            int n_new = 0;
+            for(Halfedge fh: mesh.halfedges(f))
+                if(mesh.to_vertex(fh).idx() >= nv) { h = fh; ++n_new; }
+            if(n_new==0) continue;
+            int nf = mesh.faces_size();
+            if(fred[f]){
+                mesh.insert_edge(h, mesh.next_halfedge(mesh.next_halfedge(h)));
+                h = mesh.next_halfedge(h);
+                mesh.insert_edge(h, mesh.next_halfedge(mesh.next_halfedge(h)));
+                h = mesh.next_halfedge(h);
+                mesh.insert_edge(h, mesh.next_halfedge(mesh.next_halfedge(h)));
+            } else {
+                mesh.insert_edge(h, mesh.next_halfedge(mesh.next_halfedge(h)));
+            }
+            if(fselected && fselected[f])
+                for(int i=nf; i<(int)mesh.faces_size(); ++i)
+                    fselected[Face(i)] = true;
+        }
+
+        mesh.remove_face_property(fred);
+        mesh.remove_edge_property(esplit);
+        mesh.remove_edge_property(epoint);
+        mesh.remove_vertex_property(vpoint);
+    }
+}
+
+void SurfaceMeshSubdivideLoop::exec_selected(OpenGP::SurfaceMesh& mesh, int levels){
+    FaceProperty<bool> fselected = mesh.get_face_property<bool>("f:selected");
+    CHECK(fselected);
+    exec(mesh, [&](Face f){ return (bool) fselected[f]; }, levels);
+}
+
+SurfaceMeshLoopStencils::SurfaceMeshLoopStencils(const OpenGP::SurfaceMesh& control, int levels){
+    using namespace OpenGP::internal;
+    CHECK(control.is_triangle_mesh());
+
+    LoopLevel L;
+    loop_flatten(control, L);
+
+    ///--- columns are indexed by control vertex handles (deleted vertices get no weight)
+    typedef Eigen::Triplet<Scalar> Triplet;
+    std::vector<Triplet> triplets;
+    int nrow = 0;
+    for(Vertex v: control.vertices())
+        triplets.push_back(Triplet(nrow++, v.idx(), Scalar(1)));
+    stencils_.resize(nrow, control.vertices_size());
+    stencils_.setFromTriplets(triplets.begin(), triplets.end());
+
+    ///--- every level expands the rows of the previous level by the Loop rules
+    ///    (sparse product with a dense accumulator over the control vertices)
+    std::vector<Scalar> accum(control.vertices_size(), 0);
+    std::vector<int> touched;
+    for(int level = 0; level < levels; level++){
+        LoopTopology T(L);
+        const int nv = L.n_vertices();
+        const int ne = T.n_edges();
+
+        StencilMatrix next(nv + ne, control.vertices_size());
+        next.reserve(Eigen::VectorXi::Constant(nv + ne, 4 * (int)(stencils_.nonZeros() / std::max(nv, 1) + 1)));
+        auto expand = [&](int i, Scalar w){
+            for(StencilMatrix::InnerIterator it(stencils_, i); it; ++it){
+                if(accum[it.col()] == 0) touched.push_back((int) it.col());
+                accum[it.col()] += w * it.value();
+            }
+        };
+        auto flush = [&](int row){
+            std::sort(touched.begin(), touched.end());
+            for(int col: touched){
+                if(accum[col] != 0) next.insert(row, col) = accum[col];
+                accum[col] = 0;
+            }
+            touched.clear();
+        };
+        for(int v = 0; v < nv; v++){
+            loop_vertex_rule(L, T, v, expand);
+            flush(v);
+        }
+        for(int e = 0; e < ne; e++){
+            loop_edge_rule(L, T, e, expand);
+            flush(nv + e);
+        }
+        next.makeCompressed();
+        stencils_.swap(next);
+
+        LoopLevel R;
+        loop_refine_topology(L, T, R);
+        std::swap(L, R);
+    }
+
+    triangles_.swap(L.triangles);
+    vfeature_.swap(L.vfeature);
+    cfeature_.swap(L.cfeature);
+}
+
+void SurfaceMeshLoopStencils::eval(const OpenGP::Vec3* control, OpenGP::Vec3* refined) const{
+    const int n = (int) stencils_.rows();
+    #pragma omp parallel for schedule(static)
+    for(int r = 0; r < n; r++){
+        Point p = Point::Zero();
+        for(StencilMatrix::InnerIterator it(stencils_, r); it; ++it)
+            p += it.value() * control[it.col()];
+        refined[r] = p;
+    }
+}
+
+void SurfaceMeshLoopStencils::eval(const OpenGP::SurfaceMesh& control, OpenGP::SurfaceMesh& refined) const{
+    CHECK(refined.vertices_size() == stencils_.rows());
+    VertexProperty<Point> cpoints = control.get_vertex_property<Point>("v:point");
+    VertexProperty<Point> rpoints = refined.vertex_property<Point>("v:point");
+    eval(cpoints.data(), rpoints.vector().data());
+}
+
+void SurfaceMeshLoopStencils::build(const OpenGP::SurfaceMesh& control, OpenGP::SurfaceMesh& refined) const{
+    std::vector<Point> points(stencils_.rows());
+    VertexProperty<Point> cpoints = control.get_vertex_property<Point>("v:point");
+    eval(cpoints.data(), points.data());
+    refined.build_triangles(points, triangles_);
+
+    ///--- crease tags
+    if(control.get_vertex_property<bool>("v:feature")){
+        VertexProperty<bool> vfeature = refined.vertex_property<bool>("v:feature", false);
+        for(Vertex v: refined.vertices())
+            vfeature[v] = vfeature_[v.idx()];
+    }
+    if(control.get_edge_property<bool>("e:feature")){
+        EdgeProperty<bool> efeature = refined.edge_property<bool>("e:feature", false);
+        for(Face f: refined.faces()){
+            for(Halfedge h: refined.halfedges(f)){
+                for(int c = 3*f.idx(); c < 3*f.idx()+3; c++)
+                    if(triangles_[c] == refined.from_vertex(h).idx())
+                        efeature[refined.edge(h)] = cfeature_[c];
+            }
+        }
+    }
+}
@@ -1,10 +1,65 @@
 #pragma once
+#include <vector>
+#include <functional>
+#include <Eigen/Sparse>
 #include <OpenGP/headeronly.h>
 #include <OpenGP/SurfaceMesh/Algorithm.h>
 
 class SurfaceMeshSubdivideLoop : public OpenGP::SurfaceMeshAlgorithm{
 public:
+    /// One level of refinement through halfedge surgery (keeps custom properties)
     static HEADERONLY_INLINE void exec(OpenGP::SurfaceMesh& mesh);
+    /// \c levels of refinement on flat vertex/triangle arrays (parallel), the refined
+    /// mesh is rebuilt in bulk at the end. Only the "v:feature"/"e:feature" properties
+    /// are carried over, other custom properties are cleared.
+    static HEADERONLY_INLINE void exec(OpenGP::SurfaceMesh& mesh, int levels);
+    /// Adaptive refinement limited to the faces for which \c refine returns true (the
+    /// predicate is re-evaluated at every level). Red-green closure keeps the mesh
+    /// conforming: faces with two or more split edges are refined regularly, faces
+    /// with a single split edge are bisected. Only vertices whose faces are all
+    /// refined are smoothed, the rest of the mesh keeps its geometry. Children of
+    /// faces tagged in "f:selected" inherit the tag.
+    static HEADERONLY_INLINE void exec(OpenGP::SurfaceMesh& mesh, const std::function<bool(Face)>& refine, int levels=1);
+    /// Adaptive refinement of the faces tagged in the "f:selected" face property
+    static HEADERONLY_INLINE void exec_selected(OpenGP::SurfaceMesh& mesh, int levels=1);
+
+private:
+    /// Loop vertex rule (smooth, boundary and crease cases) on the halfedge mesh
+    static HEADERONLY_INLINE Point vertex_point(const OpenGP::SurfaceMesh& mesh, Vertex v, const VertexProperty<Point>& points,
+                                                const VertexProperty<bool>& vfeature, const EdgeProperty<bool>& efeature);
+    /// Loop edge rule (smooth, boundary and crease cases) on the halfedge mesh
+    static HEADERONLY_INLINE Point edge_point(const OpenGP::SurfaceMesh& mesh, Edge e, const VertexProperty<Point>& points,
+                                              const EdgeProperty<bool>& efeature);
+};
+
+/// Loop subdivision of a fixed control topology, for control meshes that deform
+/// over time. The constructor analyzes the topology once and records every refined
+/// vertex as a sparse weighted combination (stencil) of control vertices; eval() then
+/// only performs a (parallel) sparse matrix-vector product over "v:point".
+class SurfaceMeshLoopStencils : public OpenGP::SurfaceMeshAlgorithm{
+public:
+    /// row r holds the weights of refined vertex r, columns are control vertex indices
+    typedef Eigen::SparseMatrix<Scalar, Eigen::RowMajor> StencilMatrix;
+
+    /// precomputes the stencils of \c levels Loop refinements of \c control
+    HEADERONLY_INLINE SurfaceMeshLoopStencils(const OpenGP::SurfaceMesh& control, int levels);
+
+    /// clears \c refined and builds it from the current \c control positions (call once)
+    HEADERONLY_INLINE void build(const OpenGP::SurfaceMesh& control, OpenGP::SurfaceMesh& refined) const;
+    /// updates the positions of a mesh made by build() from the current \c control positions
+    HEADERONLY_INLINE void eval(const OpenGP::SurfaceMesh& control, OpenGP::SurfaceMesh& refined) const;
+    /// raw version: \c control is indexed by vertex index, \c refined has n_refined() entries
+    HEADERONLY_INLINE void eval(const OpenGP::Vec3* control, OpenGP::Vec3* refined) const;
+
+    const StencilMatrix& stencils() const { return stencils_; }
+    const std::vector<int>& triangles() const { return triangles_; }
+    int n_refined() const { return (int) stencils_.rows(); }
+
+private:
+    StencilMatrix stencils_;
+    std::vector<int> triangles_;
+    std::vector<char> vfeature_;
+    std::vector<char> cfeature_;
 };
 
 #ifdef HEADERONLY
@@ -346,6 +346,142 @@ add_quad(Vertex v0, Vertex v1, Vertex v2, Vertex v3)
 //-----------------------------------------------------------------------------
 
 
+void
+SurfaceMesh::
+build_triangles(const std::vector<Vec3>& points, const std::vector<int>& triangles)
+{
+    clear();
+
+    const int nv = (int) points.size();
+    const int nc = (int) triangles.size(); // corners, i.e. face halfedges
+    const int nf = nc / 3;
+
+    // corner c is the halfedge tail(c) -> head(c) of face c/3
+    auto next_corner = [](int c) { return (c % 3 == 2) ? c - 2 : c + 1; };
+    auto prev_corner = [](int c) { return (c % 3 == 0) ? c + 2 : c - 1; };
+    auto tail = [&](int c) { return triangles[c]; };
+    auto head = [&](int c) { return triangles[next_corner(c)]; };
+
+    // outgoing corners per vertex (counting sort)
+    std::vector<int> out_begin(nv+1, 0), out(nc);
+    for (int c=0; c<nc; ++c)
+        ++out_begin[tail(c)+1];
+    for (int v=0; v<nv; ++v)
+        out_begin[v+1] += out_begin[v];
+    std::vector<int> out_end(out_begin.begin(), out_begin.end()-1);
+    for (int c=0; c<nc; ++c)
+        out[out_end[tail(c)]++] = c;
+
+    // opposite corners (-1 on the boundary)
+    std::vector<int> opposite(nc, -1);
+    #pragma omp parallel for
+    for (int c=0; c<nc; ++c)
+    {
+        const int a = tail(c), b = head(c);
+        for (int i=out_begin[b]; i<out_begin[b+1]; ++i)
+            if (head(out[i]) == a) { opposite[c] = out[i]; break; }
+    }
+
+    // complex edges break the symmetry of opposite (or leave two boundary
+    // halfedges), more than one outgoing boundary halfedge makes a vertex non-manifold
+    int n_complex = 0;
+    std::vector<int> n_boundary_out(nv, 0);
+    for (int c=0; c<nc; ++c)
+    {
+        if (tail(c) == head(c))
+            ++n_complex;
+        else if (opposite[c] >= 0 && opposite[opposite[c]] != c)
+            ++n_complex;
+        else if (opposite[c] < 0 && ++n_boundary_out[head(c)] > 1)
+            ++n_complex;
+    }
+
+    // a pinched vertex joins several fans: walking one fan (from its boundary
+    // corner, if any) then misses some of the outgoing corners
+    if (n_complex == 0)
+    {
+        #pragma omp parallel for reduction(+:n_complex)
+        for (int v=0; v<nv; ++v)
+        {
+            if (out_begin[v] == out_begin[v+1]) continue;
+            int start = out[out_begin[v]];
+            for (int i=out_begin[v]; i<out_begin[v+1]; ++i)
+                if (opposite[out[i]] < 0) { start = out[i]; break; }
+            int n_fan = 0;
+            for (int c=start; c>=0 && (n_fan == 0 || c != start); c=opposite[prev_corner(c)])
+                ++n_fan;
+            if (n_fan != out_begin[v+1] - out_begin[v])
+                ++n_complex;
+        }
+    }
+
+    if (n_complex > 0)
+    {
+        for (int v=0; v<nv; ++v)
+            add_vertex(points[v]);
+        for (int f=0; f<nf; ++f)
+            add_triangle(Vertex(triangles[3*f]), Vertex(triangles[3*f+1]), Vertex(triangles[3*f+2]));
+        return;
+    }
+
+    // one edge per corner pair: the corner with the smaller index owns it
+    std::vector<int> corner_halfedge(nc);
+    int ne = 0;
+    for (int c=0; c<nc; ++c)
+        if (opposite[c] < 0 || c < opposite[c])
+            corner_halfedge[c] = 2 * (ne++);
+    for (int c=0; c<nc; ++c)
+        if (opposite[c] >= 0 && c > opposite[c])
+            corner_halfedge[c] = corner_halfedge[opposite[c]] + 1;
+
+    vprops_.resize(nv);
+    hprops_.resize(2*ne);
+    eprops_.resize(ne);
+    fprops_.resize(nf);
+
+    for (int v=0; v<nv; ++v)
+        vpoint_[Vertex(v)] = points[v];
+
+    // face halfedges
+    #pragma omp parallel for
+    for (int c=0; c<nc; ++c)
+    {
+        Halfedge_connectivity& hc = hconn_[Halfedge(corner_halfedge[c])];
+        hc.vertex_ = Vertex(head(c));
+        hc.face_ = Face(c / 3);
+        hc.next_halfedge_ = Halfedge(corner_halfedge[next_corner(c)]);
+        hc.prev_halfedge_ = Halfedge(corner_halfedge[prev_corner(c)]);
+    }
+    for (int f=0; f<nf; ++f)
+        set_halfedge(Face(f), Halfedge(corner_halfedge[3*f]));
+
+    // boundary halfedges run head(c) -> tail(c) and are chained through their vertices
+    std::vector<int> boundary_out(nv, -1);
+    for (int c=0; c<nc; ++c)
+        if (opposite[c] < 0)
+            boundary_out[head(c)] = corner_halfedge[c] ^ 1;
+    for (int c=0; c<nc; ++c)
+    {
+        if (opposite[c] >= 0) continue;
+        Halfedge h(corner_halfedge[c] ^ 1);
+        set_vertex(h, Vertex(tail(c)));
+        set_next_halfedge(h, Halfedge(boundary_out[tail(c)]));
+    }
+
+    // outgoing halfedges (boundary ones for boundary vertices)
+    for (int v=0; v<nv; ++v)
+    {
+        if (boundary_out[v] >= 0)
+            set_halfedge(Vertex(v), Halfedge(boundary_out[v]));
+        else if (out_begin[v] < out_begin[v+1])
+            set_halfedge(Vertex(v), Halfedge(corner_halfedge[out[out_begin[v]]]));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 SurfaceMesh::Face
 SurfaceMesh::
 add_face(const std::vector<Vertex>& vertices)
@@ -908,6 +908,12 @@ public: //----------------------------------------------- add new vertex / face
     /// \sa add_triangle, add_face
     HEADERONLY_INLINE Face add_quad(Vertex v1, Vertex v2, Vertex v3, Vertex v4);
 
+    /// clear the mesh and rebuild it from \c points and the vertex index triples in
+    /// \c triangles. The halfedge connectivity is set up in bulk, which is much faster
+    /// than repeated add_triangle(); non-manifold input falls back to add_triangle().
+    /// \sa add_triangle, clear
+    HEADERONLY_INLINE void build_triangles(const std::vector<Vec3>& points, const std::vector<int>& triangles);
+
     //@}
 
 
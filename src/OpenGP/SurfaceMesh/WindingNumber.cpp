@@ -0,0 +1,125 @@
+#include "WindingNumber.h"
+#include <cmath>
+#include <vector>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+WindingNumber::WindingNumber(const SurfaceMesh& mesh, Scalar beta) : beta(beta){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+
+    ///--- fan triangulation
+    std::vector<Vec3> corners;
+    std::vector<Vec3> poly;
+    for(auto f: mesh.faces()){
+        poly.clear();
+        for(auto v: mesh.vertices(f))
+            poly.push_back(vpoints[v]);
+        for(size_t i=2; i<poly.size(); ++i){
+            corners.push_back(poly[0]);
+            corners.push_back(poly[i-1]);
+            corners.push_back(poly[i]);
+        }
+    }
+    int n = (int) corners.size()/3;
+    std::vector<Box3> boxes(n);
+    for(int i=0; i<n; ++i){
+        boxes[i].setEmpty();
+        for(int k=0; k<3; ++k)
+            boxes[i].extend(corners[3*i+k]);
+    }
+    bvh.build(boxes);
+
+    tri_points.resize(3*n);
+    for(int i=0; i<n; ++i)
+        for(int k=0; k<3; ++k)
+            tri_points[3*i+k] = corners[3*bvh.primitives()[i]+k];
+
+    ///--- dipoles bottom up, children are stored after their parent
+    const std::vector<BVH3::Node>& nodes = bvh.nodes();
+    int nn = (int) nodes.size();
+    node_center.resize(nn);
+    node_normal.resize(nn);
+    node_radius.resize(nn);
+    std::vector<Scalar> node_area(nn);
+    for(int k=nn-1; k>=0; --k){
+        const BVH3::Node& node = nodes[k];
+        if(node.is_leaf()){
+            Vec3 N = Vec3::Zero(), C = Vec3::Zero();
+            Scalar A = 0;
+            for(int i=node.first; i<node.first+node.count; ++i){
+                const Vec3* t = &tri_points[3*i];
+                Vec3 n = (t[1]-t[0]).cross(t[2]-t[0]) / 2;
+                Scalar a = n.norm();
+                N += n;
+                C += a * (t[0]+t[1]+t[2]) / 3;
+                A += a;
+            }
+            C = (A>0) ? Vec3(C/A) : node.box.center();
+            Scalar r = 0;
+            for(int i=3*node.first; i<3*(node.first+node.count); ++i)
+                r = std::max(r, (tri_points[i]-C).norm());
+            node_center[k] = C;
+            node_normal[k] = N;
+            node_area[k] = A;
+            node_radius[k] = r;
+        } else {
+            int l = node.first, rr = node.first+1;
+            Scalar A = node_area[l] + node_area[rr];
+            Vec3 C = (A>0) ? Vec3((node_area[l]*node_center[l] + node_area[rr]*node_center[rr]) / A) : node.box.center();
+            node_center[k] = C;
+            node_normal[k] = node_normal[l] + node_normal[rr];
+            node_area[k] = A;
+            node_radius[k] = std::max((node_center[l]-C).norm() + node_radius[l], (node_center[rr]-C).norm() + node_radius[rr]);
+        }
+    }
+}
+
+Scalar WindingNumber::winding_number(const Vec3& p) const{
+    if(bvh.empty()) return 0;
+    const std::vector<BVH3::Node>& nodes = bvh.nodes();
+    ///--- sum of solid angles, accumulated in double
+    double omega = 0;
+    std::vector<int> stack(1, 0);
+    while(!stack.empty()){
+        int k = stack.back();
+        stack.pop_back();
+        Vec3 d = node_center[k] - p;
+        Scalar dist2 = d.squaredNorm();
+        if(dist2 > beta*beta * node_radius[k]*node_radius[k]){
+            ///--- dipole: the far field of the summed area vector at the centroid
+            omega += double(d.dot(node_normal[k])) / (double(dist2) * std::sqrt(double(dist2)));
+            continue;
+        }
+        const BVH3::Node& node = nodes[k];
+        if(!node.is_leaf()){
+            stack.push_back(node.first);
+            stack.push_back(node.first+1);
+            continue;
+        }
+        ///--- exact solid angle of each triangle (Van Oosterom & Strackee '83)
+        for(int i=node.first; i<node.first+node.count; ++i){
+            Eigen::Vector3d a = (tri_points[3*i]-p).cast<double>();
+            Eigen::Vector3d b = (tri_points[3*i+1]-p).cast<double>();
+            Eigen::Vector3d c = (tri_points[3*i+2]-p).cast<double>();
+            double la = a.norm(), lb = b.norm(), lc = c.norm();
+            double det = a.dot(b.cross(c));
+            double den = la*lb*lc + a.dot(b)*lc + b.dot(c)*la + c.dot(a)*lb;
+            omega += 2*std::atan2(det, den);
+        }
+    }
+    return Scalar(omega / (4*M_PI));
+}
+
+void WindingNumber::winding_number(const Mat3xN& points, VecN& w) const{
+    int n = (int) points.cols();
+    w.resize(n);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int i=0; i<n; ++i)
+        w[i] = winding_number(Vec3(points.col(i)));
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
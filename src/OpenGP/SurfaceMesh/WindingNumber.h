@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+#include <OpenGP/util/BVH3.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Generalized winding number (Jacobson et al. '13) of a surface mesh: close to
+/// 1 inside and 0 outside, degrading gracefully on meshes with holes or
+/// self-intersections where ray parity fails. Far clusters of triangles are
+/// replaced by their dipole (Barnes-Hut, Barill et al. '18), so queries cost
+/// O(log faces). Faces are fan triangulated, rebuild the object after the mesh changed.
+class WindingNumber{
+public:
+    /// a cluster is approximated once the query is \c beta times its radius
+    /// away from its center, larger values are slower and more accurate
+    HEADERONLY_INLINE WindingNumber(const SurfaceMesh& mesh, Scalar beta=2);
+
+    /// winding number at \c p
+    HEADERONLY_INLINE Scalar winding_number(const Vec3& p) const;
+    /// winding numbers of the columns of \c points, in parallel
+    HEADERONLY_INLINE void winding_number(const Mat3xN& points, VecN& w) const;
+
+    bool is_inside(const Vec3& p) const { return winding_number(p) > Scalar(0.5); }
+
+private:
+    Scalar beta;
+    BVH3 bvh;
+    std::vector<Vec3> tri_points;   ///< 3 per triangle, in BVH leaf order
+    ///--- per node dipole: area weighted centroid, summed area vector, radius around the centroid
+    std::vector<Vec3> node_center;
+    std::vector<Vec3> node_normal;
+    std::vector<Scalar> node_radius;
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "WindingNumber.cpp"
+#endif
@@ -0,0 +1,166 @@
+#include "analyze.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// Union-find safe for concurrent unite() calls: a root is only ever linked
+/// (by compare-and-swap) under a smaller index, paths are halved during find().
+class ConcurrentUnionFind{
+public:
+    ConcurrentUnionFind(int n) : parent(n){
+        for(int i=0; i<n; ++i) parent[i].store(i, std::memory_order_relaxed);
+    }
+    int find(int i){
+        while(true){
+            int p = parent[i].load(std::memory_order_relaxed);
+            if(p == i) return i;
+            int gp = parent[p].load(std::memory_order_relaxed);
+            if(gp != p) parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            i = gp;
+        }
+    }
+    void unite(int a, int b){
+        while(true){
+            a = find(a);
+            b = find(b);
+            if(a == b) return;
+            if(a < b) std::swap(a, b);
+            int expected = a;
+            if(parent[a].compare_exchange_strong(expected, b)) return;
+        }
+    }
+private:
+    std::vector<std::atomic<int>> parent;
+};
+
+} // internal
+
+SurfaceMeshAnalysis analyze(const SurfaceMesh& mesh){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    CHECK(vpoints);
+    int nv = mesh.vertices_size(), ne = mesh.edges_size(), nf = mesh.faces_size();
+
+    SurfaceMeshAnalysis A;
+    A.n_vertices = mesh.n_vertices();
+    A.n_edges = mesh.n_edges();
+    A.n_faces = mesh.n_faces();
+    A.euler_characteristic = A.n_vertices - A.n_edges + A.n_faces;
+    A.bbox.setNull();
+    A.min_edge_length = std::numeric_limits<Scalar>::max();
+    A.max_edge_length = 0;
+    double sum_edge_length = 0;
+
+    internal::ConcurrentUnionFind vertex_sets(nv);
+    internal::ConcurrentUnionFind boundary_sets(mesh.halfedges_size());
+
+    #pragma omp parallel
+    {
+        Box3 bbox;
+        bbox.setNull();
+        int isolated = 0, nonmanifold = 0, degenerate = 0, triangles = 0;
+        Scalar min_length = std::numeric_limits<Scalar>::max(), max_length = 0;
+        double sum_length = 0;
+
+        #pragma omp for schedule(dynamic, 1024) nowait
+        for(int vi=0; vi<nv; ++vi){
+            SurfaceMesh::Vertex v(vi);
+            if(mesh.is_deleted(v)) continue;
+            bbox.extend(vpoints[v]);
+            if(mesh.is_isolated(v)) ++isolated;
+            else if(!mesh.is_manifold(v)) ++nonmanifold;
+        }
+
+        ///--- components merged across edges, boundary loops across consecutive boundary halfedges
+        #pragma omp for schedule(dynamic, 1024) nowait
+        for(int ei=0; ei<ne; ++ei){
+            SurfaceMesh::Edge e(ei);
+            if(mesh.is_deleted(e)) continue;
+            SurfaceMesh::Vertex v0 = mesh.vertex(e, 0), v1 = mesh.vertex(e, 1);
+            Scalar length = (vpoints[v1] - vpoints[v0]).norm();
+            min_length = std::min(min_length, length);
+            max_length = std::max(max_length, length);
+            sum_length += length;
+            vertex_sets.unite(v0.idx(), v1.idx());
+            for(int k=0; k<2; ++k){
+                SurfaceMesh::Halfedge h = mesh.halfedge(e, k);
+                if(mesh.is_boundary(h))
+                    boundary_sets.unite(h.idx(), mesh.next_halfedge(h).idx());
+            }
+        }
+
+        #pragma omp for schedule(dynamic, 1024) nowait
+        for(int fi=0; fi<nf; ++fi){
+            SurfaceMesh::Face f(fi);
+            if(mesh.is_deleted(f)) continue;
+            int valence = 0;
+            Vec3 origin = vpoints[mesh.to_vertex(mesh.halfedge(f))];
+            Vec3 vector_area = Vec3::Zero();
+            Scalar max_length2 = 0;
+            for(auto h: mesh.halfedges(f)){
+                Vec3 a = vpoints[mesh.from_vertex(h)], b = vpoints[mesh.to_vertex(h)];
+                vector_area += (a - origin).cross(b - origin);
+                max_length2 = std::max(max_length2, (b - a).squaredNorm());
+                ++valence;
+            }
+            if(valence == 3) ++triangles;
+            if(vector_area.norm() <= std::numeric_limits<Scalar>::epsilon() * max_length2) ++degenerate;
+        }
+
+        #pragma omp critical
+        {
+            A.bbox.extend(bbox);
+            A.n_isolated_vertices += isolated;
+            A.n_nonmanifold_vertices += nonmanifold;
+            A.n_degenerate_faces += degenerate;
+            A.n_triangles += triangles;
+            A.min_edge_length = std::min(A.min_edge_length, min_length);
+            A.max_edge_length = std::max(A.max_edge_length, max_length);
+            sum_edge_length += sum_length;
+        }
+    }
+    if(A.n_edges > 0) A.mean_edge_length = Scalar(sum_edge_length / A.n_edges);
+    else A.min_edge_length = 0;
+
+    ///--- one loop per set of boundary halfedges
+    int n_loops = 0, n_boundary = 0;
+    #pragma omp parallel for reduction(+:n_loops, n_boundary)
+    for(int hi=0; hi<(int) mesh.halfedges_size(); ++hi){
+        SurfaceMesh::Halfedge h(hi);
+        if(mesh.is_deleted(mesh.edge(h)) || !mesh.is_boundary(h)) continue;
+        ++n_boundary;
+        if(boundary_sets.find(hi) == hi) ++n_loops;
+    }
+    A.n_boundary_edges = n_boundary;
+    A.n_boundary_loops = n_loops;
+
+    ///--- component ids in order of their smallest vertex
+    A.vertex_component.assign(nv, -1);
+    for(int vi=0; vi<nv; ++vi){
+        SurfaceMesh::Vertex v(vi);
+        if(!mesh.is_deleted(v) && !mesh.is_isolated(v) && vertex_sets.find(vi) == vi)
+            A.vertex_component[vi] = A.n_components++;
+    }
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int vi=0; vi<nv; ++vi){
+        SurfaceMesh::Vertex v(vi);
+        if(mesh.is_deleted(v) || mesh.is_isolated(v)) continue;
+        int root = vertex_sets.find(vi);
+        if(root != vi) A.vertex_component[vi] = A.vertex_component[root];
+    }
+
+    ///--- chi = 2C - 2g - B, counted on the surface without isolated vertices
+    if(A.n_nonmanifold_vertices == 0)
+        A.genus = (2*A.n_components - A.n_boundary_loops - (A.euler_characteristic - A.n_isolated_vertices)) / 2;
+    return A;
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Topology and geometry summary of a surface mesh, see analyze()
+struct SurfaceMeshAnalysis{
+    int n_vertices = 0, n_edges = 0, n_faces = 0; ///< without deleted elements
+    int n_isolated_vertices = 0;
+    int n_components = 0;            ///< connected components of faces, isolated vertices excluded
+    int n_boundary_edges = 0;
+    int n_boundary_loops = 0;
+    int n_nonmanifold_vertices = 0;  ///< vertices joining several patches (see SurfaceMesh::is_manifold)
+    int n_degenerate_faces = 0;      ///< faces of (numerically) zero area
+    int n_triangles = 0;
+    int euler_characteristic = 0;    ///< V - E + F
+    int genus = -1;                  ///< total genus of an orientable manifold mesh, -1 if there are non-manifold vertices
+    Scalar min_edge_length = 0, max_edge_length = 0, mean_edge_length = 0;
+    Box3 bbox;                       ///< of the non deleted vertices
+    std::vector<int> vertex_component; ///< per vertex index, -1 for deleted and isolated vertices
+
+    bool is_triangle_mesh() const { return n_triangles == n_faces; }
+    bool is_closed() const { return n_boundary_edges == 0; }
+    bool is_manifold() const { return n_nonmanifold_vertices == 0; }
+};
+
+/// Computes all of SurfaceMeshAnalysis in one parallel region: vertices, edges
+/// and faces are traversed once each with per-thread partial results, components
+/// come from a lock-free union-find over the edges (boundary loops likewise over
+/// the boundary halfedges), labeled afterwards by a parallel find().
+HEADERONLY_INLINE SurfaceMeshAnalysis analyze(const SurfaceMesh& mesh);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "analyze.cpp"
+#endif
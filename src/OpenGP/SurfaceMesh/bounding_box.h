@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include <OpenGP/SurfaceMesh/SurfaceMesh.h>
 
 //=============================================================================
@@ -29,6 +30,24 @@ inline Box3 bounding_box(const SurfaceMesh& mesh)
     return bbox;
 }
 
+/// boxes of the faces in the order of mesh.faces() (deleted faces are skipped), e.g. for BVH3
+inline void face_boxes(const SurfaceMesh& mesh, std::vector<Box3>& boxes)
+{
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    std::vector<SurfaceMesh::Face> faces;
+    faces.reserve(mesh.n_faces());
+    for(auto f: mesh.faces())
+        faces.push_back(f);
+    int n = (int) faces.size();
+    boxes.resize(n);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int i=0; i<n; ++i){
+        boxes[i].setEmpty();
+        for(auto v: mesh.vertices(faces[i]))
+            boxes[i].extend(vpoints[v]);
+    }
+}
+
 /// turn bounding box into a bounding cube (same edge lengths)
 inline Box3 bbox_cubified(const Box3& box){
     // TODO: move this function to OpenGP/Types
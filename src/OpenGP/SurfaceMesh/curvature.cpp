@@ -0,0 +1,177 @@
+#include "curvature.h"
+#include <OpenGP/MLogger.h>
+#include <cmath>
+#include <limits>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// eigenvalues l0 <= l1 of the symmetric matrix [a b; b c], and the unit eigenvector of l1
+inline void eigen_symmetric2(Scalar a, Scalar b, Scalar c, Scalar& l0, Scalar& l1, Vec2& v1){
+    Scalar m = (a+c)/2;
+    Scalar d = std::sqrt((a-c)*(a-c)/4 + b*b);
+    l0 = m-d;
+    l1 = m+d;
+    Vec2 u(l1-c, b), w(b, l1-a);
+    v1 = (u.squaredNorm() > w.squaredNorm()) ? u : w;
+    Scalar norm = v1.norm();
+    v1 = (norm > 0) ? Vec2(v1/norm) : Vec2(1,0);
+}
+
+/// a unit vector orthogonal to the unit vector n
+inline Vec3 tangent_of(const Vec3& n){
+    Vec3 t = (std::abs(n.x()) < Scalar(0.9)) ? Vec3(1,0,0) : Vec3(0,1,0);
+    return (t - n.dot(t)*n).normalized();
+}
+
+} // internal
+
+VertexCurvatures curvatures(const SurfaceMesh& mesh, CurvatureMethod method){
+    CHECK(mesh.is_triangle_mesh());
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    int nv = mesh.vertices_size();
+    int nf = mesh.faces_size();
+
+    ///--- per face: area, unit normal; per face halfedge: angle at its origin, cotangent of the opposite angle
+    std::vector<Scalar> farea(nf, 0);
+    std::vector<Vec3> fnormal(nf, Vec3::Zero());
+    std::vector<Scalar> hangle(mesh.halfedges_size(), 0);
+    std::vector<Scalar> hcot(mesh.halfedges_size(), 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int fi=0; fi<nf; ++fi){
+        SurfaceMesh::Face f(fi);
+        if(mesh.is_deleted(f)) continue;
+        SurfaceMesh::Halfedge h[3];
+        h[0] = mesh.halfedge(f);
+        h[1] = mesh.next_halfedge(h[0]);
+        h[2] = mesh.next_halfedge(h[1]);
+        Vec3 p[3];
+        for(int k=0; k<3; ++k)
+            p[k] = vpoints[mesh.from_vertex(h[k])];
+        Vec3 N = (p[1]-p[0]).cross(p[2]-p[0]);
+        Scalar double_area = N.norm();
+        if(double_area < std::numeric_limits<Scalar>::min()) continue;
+        farea[fi] = double_area/2;
+        fnormal[fi] = N/double_area;
+        for(int k=0; k<3; ++k){
+            Scalar d = (p[(k+1)%3]-p[k]).dot(p[(k+2)%3]-p[k]);
+            hangle[h[k].idx()] = std::atan2(double_area, d);
+            hcot[h[(k+1)%3].idx()] = d/double_area;
+        }
+    }
+
+    VertexCurvatures C;
+    C.mean.assign(nv, 0);
+    C.gauss.assign(nv, 0);
+    C.kmin.assign(nv, 0);
+    C.kmax.assign(nv, 0);
+    C.dmin.assign(nv, Vec3::Zero());
+    C.dmax.assign(nv, Vec3::Zero());
+    C.normals.assign(nv, Vec3::Zero());
+    C.areas.assign(nv, 0);
+
+    ///--- per vertex, gathered from the outgoing halfedges
+    #pragma omp parallel for schedule(dynamic, 256)
+    for(int vi=0; vi<nv; ++vi){
+        SurfaceMesh::Vertex v(vi);
+        if(mesh.is_deleted(v) || mesh.is_isolated(v)) continue;
+        const Vec3& p = vpoints[v];
+        Scalar area = 0, angle_sum = 0;
+        Vec3 n = Vec3::Zero(), laplace = Vec3::Zero();
+        for(auto h: mesh.halfedges(v)){
+            laplace += (hcot[h.idx()] + hcot[mesh.opposite_halfedge(h).idx()])/2 * (vpoints[mesh.to_vertex(h)] - p);
+            if(mesh.is_boundary(h)) continue;
+            int f = mesh.face(h).idx();
+            area += farea[f]/3;
+            angle_sum += hangle[h.idx()];
+            n += hangle[h.idx()] * fnormal[f];
+        }
+        if(area <= 0 || n.squaredNorm() == 0) continue;
+        n.normalize();
+        C.normals[vi] = n;
+        C.areas[vi] = area;
+
+        ///--- mean curvature normal and angle defect
+        Scalar H = -laplace.dot(n) / (2*area);
+        Scalar K = ((mesh.is_boundary(v) ? M_PI : 2*M_PI) - angle_sum) / area;
+        Scalar d = std::sqrt(std::max(H*H - K, Scalar(0)));
+        Scalar kmin = H-d, kmax = H+d;
+
+        Vec3 t1 = internal::tangent_of(n);
+        Vec3 t2 = n.cross(t1);
+        Scalar a = 0, b = 0, c = 0;
+        Vec2 dir(1,0);
+        if(method == CURVATURE_COTAN){
+            ///--- directions of the normal curvature tensor, edges weighted by their faces' areas
+            for(auto h: mesh.halfedges(v)){
+                Vec3 e = vpoints[mesh.to_vertex(h)] - p;
+                Scalar l2 = e.squaredNorm();
+                Vec3 T = e - n.dot(e)*n;
+                if(l2 == 0 || T.squaredNorm() == 0) continue;
+                T.normalize();
+                Scalar kn = -2*n.dot(e)/l2;
+                Scalar w = 0;
+                if(!mesh.is_boundary(h)) w += farea[mesh.face(h).idx()];
+                if(!mesh.is_boundary(mesh.opposite_halfedge(h))) w += farea[mesh.face(mesh.opposite_halfedge(h)).idx()];
+                Scalar x = T.dot(t1), y = T.dot(t2);
+                a += w*kn*x*x;
+                b += w*kn*x*y;
+                c += w*kn*y*y;
+            }
+            Scalar l0, l1;
+            internal::eigen_symmetric2(a, b, c, l0, l1, dir);
+        } else {
+            ///--- height field z = a x^2 + b xy + c y^2 over the tangent plane
+            Eigen::Matrix3d AtA = Eigen::Matrix3d::Zero();
+            Eigen::Vector3d Atz = Eigen::Vector3d::Zero();
+            for(auto h: mesh.halfedges(v)){
+                Vec3 e = vpoints[mesh.to_vertex(h)] - p;
+                double x = e.dot(t1), y = e.dot(t2), z = e.dot(n);
+                Eigen::Vector3d r(x*x, x*y, y*y);
+                AtA += r*r.transpose();
+                Atz += r*z;
+            }
+            double scale = AtA.trace();
+            if(mesh.valence(v) >= 3 && AtA.determinant() > 1e-9*scale*scale*scale){
+                Eigen::Vector3d q = AtA.ldlt().solve(Atz);
+                ///--- shape operator -Hess(z), positive where the surface bends away from n
+                internal::eigen_symmetric2(Scalar(-2*q[0]), Scalar(-q[1]), Scalar(-2*q[2]), kmin, kmax, dir);
+                H = (kmin+kmax)/2;
+                K = kmin*kmax;
+            }
+        }
+        C.mean[vi] = H;
+        C.gauss[vi] = K;
+        C.kmin[vi] = kmin;
+        C.kmax[vi] = kmax;
+        C.dmax[vi] = dir.x()*t1 + dir.y()*t2;
+        C.dmin[vi] = n.cross(C.dmax[vi]);
+    }
+    return C;
+}
+
+void add_curvature_properties(SurfaceMesh& mesh, CurvatureMethod method){
+    VertexCurvatures C = curvatures(mesh, method);
+    auto mean = mesh.vertex_property<Scalar>("v:mean_curvature");
+    auto gauss = mesh.vertex_property<Scalar>("v:gauss_curvature");
+    auto kmin = mesh.vertex_property<Scalar>("v:kmin");
+    auto kmax = mesh.vertex_property<Scalar>("v:kmax");
+    auto dmin = mesh.vertex_property<Vec3>("v:kmin_direction");
+    auto dmax = mesh.vertex_property<Vec3>("v:kmax_direction");
+    for(auto v: mesh.vertices()){
+        int i = v.idx();
+        mean[v] = C.mean[i];
+        gauss[v] = C.gauss[i];
+        kmin[v] = C.kmin[i];
+        kmax[v] = C.kmax[i];
+        dmin[v] = C.dmin[i];
+        dmax[v] = C.dmax[i];
+    }
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+enum CurvatureMethod{
+    CURVATURE_COTAN, ///< cotan Laplacian (mean), angle defect (Gaussian), directions from the normal curvature tensor (Taubin '95)
+    CURVATURE_FIT,   ///< least squares fit of a quadratic height field over the one-ring
+};
+
+/// Per-vertex curvatures, indexed by vertex index (deleted vertices are zero).
+/// Curvatures are positive where the surface bends away from the normal, e.g.
+/// 1/r on a sphere with outward normals. Directions are unit tangent vectors.
+struct VertexCurvatures{
+    std::vector<Scalar> mean, gauss, kmin, kmax;
+    std::vector<Vec3> dmin, dmax;
+    std::vector<Vec3> normals; ///< angle weighted, used for the tangent frames
+    std::vector<Scalar> areas; ///< barycentric, curvatures are averaged over them
+};
+
+/// Curvatures of a triangle mesh. Angles, areas, cotangents and normals are
+/// computed once per face and shared by all curvature types; both passes (faces,
+/// then vertices gathering their faces) run in parallel.
+HEADERONLY_INLINE VertexCurvatures curvatures(const SurfaceMesh& mesh, CurvatureMethod method=CURVATURE_COTAN);
+
+/// Stores curvatures() in "v:mean_curvature", "v:gauss_curvature", "v:kmin",
+/// "v:kmax" (Scalar) and "v:kmin_direction", "v:kmax_direction" (Vec3). To display
+/// one with SurfaceMeshRenderShaded, copy it into "v:quality".
+HEADERONLY_INLINE void add_curvature_properties(SurfaceMesh& mesh, CurvatureMethod method=CURVATURE_COTAN);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "curvature.cpp"
+#endif
@@ -34,6 +34,10 @@ public:
     /// Let two elements swap their storage place.
     virtual void swap(size_t i0, size_t i1) = 0;
 
+    /// Move element i to map[i] (removed if map[i] < 0), keeping n elements.
+    /// The map must preserve the order of the kept elements.
+    virtual void compact(const std::vector<int>& map, size_t n) = 0;
+
     /// Return a deep copy of self.
     virtual Base_property_array* clone () const = 0;
 
@@ -96,6 +100,15 @@ public: // virtual interface of Base_property_array
         data_[i1]=d;
     }
 
+    virtual void compact(const std::vector<int>& map, size_t n)
+    {
+        vector_type data(n, value_);
+        #pragma omp parallel for schedule(static)
+        for (int i=0; i<(int)map.size(); ++i)
+            if (map[i] >= 0) data[map[i]] = data_[i];
+        data_.swap(data);
+    }
+
     virtual Base_property_array* clone() const
     {
         Property_array<T>* p = new Property_array<T>(name_, value_);
@@ -144,6 +157,17 @@ private:
 };
 
 
+// std::vector<bool> packs its elements: no concurrent writes
+template <>
+inline void
+Property_array<bool>::compact(const std::vector<int>& map, size_t n)
+{
+    for (size_t i=0; i<map.size(); ++i)
+        if (map[i] >= 0) data_[map[i]] = data_[i];
+    data_.resize(n);
+}
+
+
 // specialization for bool properties
 template <>
 inline const bool*
@@ -392,6 +416,14 @@ public:
             parrays_[i]->swap(i0, i1);
     }
 
+    // move element i to map[i] in all arrays, removing those mapped to -1
+    void compact(const std::vector<int>& map, size_t n)
+    {
+        for (unsigned int i=0; i<parrays_.size(); ++i)
+            parrays_[i]->compact(map, n);
+        size_ = n;
+    }
+
 
 private:
     std::vector<Base_property_array*>  parrays_;
@@ -1,5 +1,12 @@
 #include "remesh.h"
 #include "OpenGP/SurfaceMesh/SurfaceMesh.h"
+#include "OpenGP/util/tictoc.h"
+#include "OpenGP/SurfaceMesh/SignedDistance.h"
+#include "OpenGP/SurfaceMesh/curvature.h"
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
 
 //=============================================================================
 namespace OpenGP {
@@ -170,65 +177,9 @@ static Scalar distPointTriangleSquared( const Vec3& _p,const Vec3& _v0,const Vec
     return (_nearestPoint - _p).squaredNorm();
 }
 
-inline Scalar ClosestPointTriangle(Vec3 p, Vec3 a, Vec3 b, Vec3 c, Vec3 & closest) {
-    // Check if P in vertex region outside A
-    Vec3 ab = b - a;
-    Vec3 ac = c - a;
-    Vec3 ap = p - a;
-    Scalar d1 = dot(ab, ap);
-    Scalar d2 = dot(ac, ap);
-    if (d1 <= 0 && d2 <= 0) {
-        closest = a;
-        return (p-closest).squaredNorm(); // barycentric coordinates (1,0,0)
-    }
-    // Check if P in vertex region outside B
-    Vec3 bp = p - b;
-    Scalar d3 = dot(ab, bp);
-    Scalar d4 = dot(ac, bp);
-    if (d3 >= 0 && d4 <= d3) {
-        closest = b;
-        return (p-closest).squaredNorm(); // barycentric coordinates (0,1,0)
-    }
-    // Check if P in edge region of AB, if so return projection of P onto AB
-    Scalar vc = d1*d4 - d3*d2;
-    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
-        Scalar v = d1 / (d1 - d3);
-        closest = a + v * ab;
-        return (p - closest).squaredNorm(); // barycentric coordinates (1-v,v,0)
-    }
-    // Check if P in vertex region outside C
-    Vec3 cp = p - c;
-    Scalar d5 = dot(ab, cp);
-    Scalar d6 = dot(ac, cp);
-    if (d6 >= 0 && d5 <= d6) {
-        closest = c;
-        return (p-closest).squaredNorm(); // barycentric coordinates (0,0,1)
-    }
-    // Check if P in edge region of AC, if so return projection of P onto AC
-    Scalar vb = d5*d2 - d1*d6;
-    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
-        Scalar w = d2 / (d2 - d6);
-        closest = a + w * ac;
-        return (p - closest).squaredNorm(); // barycentric coordinates (1-w,0,w)
-    }
-    // Check if P in edge region of BC, if so return projection of P onto BC
-    Scalar va = d3*d6 - d5*d4;
-    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
-        Scalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
-        closest = b + w * (c - b);
-        return (p - closest).squaredNorm(); // barycentric coordinates (0,1-w,w)
-    }
-    // P inside face region. Compute Q through its barycentric coordinates (u,v,w)
-    Scalar denom = 1.0 / (va + vb + vc);
-    Scalar v = vb * denom;
-    Scalar w = vc * denom;
-    closest = a + ab * v + ac * w;
-    return (p - closest).squaredNorm(); // = u*a + v*b + w*c, u = va * denom = 1 - v - w
-}
-
 inline static bool TestSphereTriangle(Point sphereCenter, Scalar sphereRadius, Point a, Point b, Point c, Point &p) {
     // Find point P on triangle ABC closest to sphere center
-    ClosestPointTriangle(sphereCenter, a, b, c, p);
+    closest_point_triangle(sphereCenter, a, b, c, p);
 
     // Sphere and triangle intersect if the (squared) distance from sphere
     // center to point p is less than the (squared) sphere radius
@@ -241,12 +192,50 @@ inline static bool TestSphereTriangle(Point sphereCenter, Scalar sphereRadius, P
     return TestSphereTriangle(sphereCenter, sphereRadius, a, b, c);
 }
 
-/// performs edge splits until all edges are shorter than the threshold
-void IsotropicRemesher::splitLongEdges(Scalar maxEdgeLength ) {
+/// peak resident set size of the process (0 if the platform does not expose it)
+static size_t peak_memory_bytes() {
+#if defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; ///< bytes
+#elif defined(__unix__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * size_t(1024); ///< kilobytes
+#else
+    return 0;
+#endif
+}
+
+std::string IsotropicRemesherStats::to_json() const {
+    std::ostringstream os;
+    os << "{\"analyze_ms\": " << analyze_ms
+       << ", \"total_ms\": " << total_ms
+       << ", \"peak_memory_bytes\": " << peak_memory_bytes
+       << ", \"cancelled\": " << (cancelled ? "true" : "false")
+       << ", \"iterations\": [";
+    for (size_t i = 0; i < iterations.size(); i++) {
+        const IsotropicRemesherIteration& it = iterations[i];
+        os << (i ? ", " : "")
+           << "{\"n_vertices\": " << it.n_vertices
+           << ", \"n_splits\": " << it.n_splits
+           << ", \"n_collapses\": " << it.n_collapses
+           << ", \"n_flips\": " << it.n_flips
+           << ", \"split_ms\": " << it.split_ms
+           << ", \"collapse_ms\": " << it.collapse_ms
+           << ", \"flip_ms\": " << it.flip_ms
+           << ", \"relax_ms\": " << it.relax_ms
+           << ", \"project_ms\": " << it.project_ms
+           << ", \"total_ms\": " << it.total_ms << "}";
+    }
+    os << "]}";
+    return os.str();
+}
+
+/// performs edge splits until all edges are shorter than 4/3 of their target length
+int IsotropicRemesher::splitLongEdges() {
     *myout << __FUNCTION__ << std::endl;
     
-    const Scalar maxEdgeLengthSqr = maxEdgeLength * maxEdgeLength;
-
     SurfaceMesh::Edge_iterator e_it;
     SurfaceMesh::Edge_iterator e_end = mesh->edges_end();
 
@@ -259,14 +248,17 @@ void IsotropicRemesher::splitLongEdges(Scalar maxEdgeLength ) {
         const SurfaceMesh::Vertex & v1 = mesh->to_vertex(hh);
 
         Vec3 vec = points[v1] - points[v0];
+        const Scalar maxEdgeLength = (4.0 / 3.0) * targetLength(v0, v1);
 
         // edge too long?
-        if ( vec.squaredNorm() > maxEdgeLengthSqr ) {
+        if ( vec.squaredNorm() > maxEdgeLength * maxEdgeLength ) {
 
             const Vec3 midPoint = points[v0] + ( 0.5 * vec );
 
             // split at midpoint
             SurfaceMesh::Vertex vh = mesh->add_vertex( midPoint );
+            if ( adaptive )
+                vsizing[vh] = 0.5 * ( vsizing[v0] + vsizing[v1] );
 
             bool hadFeature = efeature[*e_it];
 
@@ -284,15 +276,14 @@ void IsotropicRemesher::splitLongEdges(Scalar maxEdgeLength ) {
     }
     
     *myout << "    split " << n_splits << " edges" << std::endl;
+    return n_splits;
 }
 
-/// collapse edges shorter than minEdgeLength if collapsing doesn't result in new edge longer than maxEdgeLength
-void IsotropicRemesher::collapseShortEdges(const Scalar _minEdgeLength, const Scalar _maxEdgeLength, bool isKeepShortEdges ) {
+/// collapse edges shorter than 4/5 of their target length if collapsing doesn't result
+/// in new edges longer than 4/3 of their target length
+int IsotropicRemesher::collapseShortEdges( bool isKeepShortEdges ) {
     *myout << __FUNCTION__ << std::endl;
     
-    const Scalar _minEdgeLengthSqr = _minEdgeLength * _minEdgeLength;
-    const Scalar _maxEdgeLengthSqr = _maxEdgeLength * _maxEdgeLength;
-
     //add checked property
     auto checked = mesh->edge_property< bool >("e:checked", false);
 
@@ -323,8 +314,10 @@ void IsotropicRemesher::collapseShortEdges(const Scalar _minEdgeLength, const Sc
             bool hadFeature = efeature[*e_it];
             if ( isKeepShortEdges && hadFeature ) continue;
 
+            const Scalar minEdgeLength = (4.0 / 5.0) * targetLength(v0, v1);
+
             // edge too short but don't try to collapse edges that have length 0
-            if ( (edgeLength < _minEdgeLengthSqr) && (edgeLength > std::numeric_limits<Scalar>::epsilon()) ) {
+            if ( (edgeLength < minEdgeLength * minEdgeLength) && (edgeLength > std::numeric_limits<Scalar>::epsilon()) ) {
 
                 //check if the collapse is ok
                 const Vec3 & B = points[v1];
@@ -333,8 +326,9 @@ void IsotropicRemesher::collapseShortEdges(const Scalar _minEdgeLength, const Sc
 
             for( SurfaceMesh::Halfedge hvit: mesh->halfedges(v0) ) {
                     Scalar d = (B - points[ mesh->to_vertex(hvit) ]).squaredNorm();
+                    Scalar maxEdgeLength = (4.0 / 3.0) * targetLength(v1, mesh->to_vertex(hvit));
 
-                    if ( d > _maxEdgeLengthSqr || mesh->is_boundary( mesh->edge( hvit ) ) || efeature[mesh->edge(hvit)] ) {
+                    if ( d > maxEdgeLength * maxEdgeLength || mesh->is_boundary( mesh->edge( hvit ) ) || efeature[mesh->edge(hvit)] ) {
                         collapse_ok = false;
                         break;
                     }
@@ -353,14 +347,17 @@ void IsotropicRemesher::collapseShortEdges(const Scalar _minEdgeLength, const Sc
     
     mesh->remove_edge_property(checked);
     mesh->garbage_collection();
+    return n_collapsed;
 }
 
-void IsotropicRemesher::equalizeValences(){
+int IsotropicRemesher::equalizeValences(){
     *myout << __FUNCTION__ << std::endl;
     
     SurfaceMesh::Edge_iterator e_it;
     SurfaceMesh::Edge_iterator e_end = mesh->edges_end();
 
+    int n_flips = 0;
+
     for (e_it = mesh->edges_begin(); e_it != e_end; ++e_it) {
 
         if ( !mesh->is_flip_ok(*e_it) ) continue;
@@ -390,9 +387,48 @@ void IsotropicRemesher::equalizeValences(){
 
                 if (deviation_pre <= deviation_post)
                     mesh->flip(*e_it);
+                else
+                    n_flips++;
             }
         }
     }
+
+    *myout << "    flipped " << n_flips << " edges" << std::endl;
+    return n_flips;
+}
+
+/// target length of the edge (v0,v1): uniform, or interpolated from the sizing field
+inline Scalar IsotropicRemesher::targetLength(const SurfaceMesh::Vertex& v0, const SurfaceMesh::Vertex& v1) {
+    if (!adaptive)
+        return longest_edge_length;
+    return 0.5 * ( vsizing[v0] + vsizing[v1] );
+}
+
+/// per-vertex target edge length from the maximal principal curvature k, following
+/// the chord error bound L = sqrt(6*eps/k - 3*eps^2), clamped to [shortest,longest].
+/// Curvatures are estimated with the cotan Laplacian (mean) and angle defect (Gaussian).
+void IsotropicRemesher::computeSizingField() {
+    *myout << __FUNCTION__ << std::endl;
+
+    ///--- User supplied sizing field?
+    vsizing = mesh->get_vertex_property<Scalar>(VSIZING);
+    if (vsizing) return;
+    vsizing = mesh->add_vertex_property<Scalar>(VSIZING, longest_edge_length);
+    owns_sizing = true;
+
+    const Scalar Lmax = longest_edge_length;
+    const Scalar Lmin = isnan(shortest_edge_length) ? 0.1 * Lmax : shortest_edge_length;
+    const Scalar eps = isnan(approximation_error) ? 0.05 * Lmax : approximation_error;
+
+    VertexCurvatures curv = curvatures(*mesh, CURVATURE_COTAN);
+    for (SurfaceMesh::Vertex v: mesh->vertices()) {
+        const int i = v.idx();
+        if (curv.areas[i] <= 0) continue;
+        Scalar kmax = std::max(std::abs(curv.kmin[i]), std::abs(curv.kmax[i]));
+        Scalar L2 = 6.0*eps/kmax - 3.0*eps*eps;
+        Scalar L = (L2 > 0) ? std::sqrt(L2) : Lmin;
+        vsizing[v] = std::min(Lmax, std::max(Lmin, L));
+    }
 }
 
 ///returns 4 for boundary vertices and 6 otherwise
@@ -427,40 +463,54 @@ void IsotropicRemesher::tangentialRelaxation() {
     mesh->update_face_normals();
     mesh->update_vertex_normals();
 
-    auto q = mesh->vertex_property<Vec3>("v:q");
     auto normal = mesh->vertex_property<Vec3>(VNORMAL);
 
-    SurfaceMesh::Vertex_iterator v_it;
-    SurfaceMesh::Vertex_iterator v_end = mesh->vertices_end();
-
-    //first compute barycenters
-    for (v_it = mesh->vertices_begin(); v_it != v_end; ++v_it) {
-
-        Vec3 tmp(0,0,0);
-        unsigned int N = 0;
-
-        for( SurfaceMesh::Halfedge hvit: mesh->halfedges(*v_it) ) {
-            tmp += points[ mesh->to_vertex(hvit) ];
-            N++;
-        }
-
-        if (N > 0)
-            tmp /= (Scalar) N;
-
-        q[*v_it] = tmp;
+    ///--- One-ring adjacency in CSR layout: the neighbors of vertex i are
+    ///    ring[ring_begin[i]] ... ring[ring_begin[i+1]-1]. Built by a counting
+    ///    sort over the (flat) halfedge array, boundary/feature vertices are
+    ///    flagged in the same pass.
+    const int nv = mesh->vertices_size();
+    std::vector<int> ring_begin(nv+1, 0);
+    std::vector<char> locked(nv, 0);
+    for(SurfaceMesh::Halfedge h: mesh->halfedges()) {
+        const int v0 = mesh->from_vertex(h).idx();
+        const int v1 = mesh->to_vertex(h).idx();
+        ring_begin[v0+1]++;
+        if( mesh->is_boundary(h) || efeature[mesh->edge(h)] )
+            locked[v0] = locked[v1] = 1;
     }
-
-    //move to new position
-    for (v_it = mesh->vertices_begin(); v_it != v_end; ++v_it) {
-        if ( !isBoundary(*v_it) && !isFeature(*v_it) ) {
-            if(reproject_on_tanget)
-                points[*v_it] = q[*v_it] + (dot(normal[*v_it], Vec3(points[*v_it] - q[*v_it]) ) * normal[*v_it]);
-            else
-                points[*v_it] = q[*v_it];
-        }
+    for(int i = 0; i < nv; i++)
+        ring_begin[i+1] += ring_begin[i];
+    std::vector<int> ring(ring_begin[nv]);
+    std::vector<int> ring_end(ring_begin.begin(), ring_begin.end()-1);
+    for(SurfaceMesh::Halfedge h: mesh->halfedges())
+        ring[ ring_end[mesh->from_vertex(h).idx()]++ ] = mesh->to_vertex(h).idx();
+
+    ///--- Barycenter + tangent projection, double buffered so every vertex
+    ///    reads the positions of the previous iteration
+    const Vec3* p_in = points.data();
+    const Vec3* n_in = normal.data();
+    std::vector<Vec3> p_out(points.vector());
+    const bool on_tangent = reproject_on_tanget;
+
+    #pragma omp parallel for schedule(static)
+    for(int i = 0; i < nv; i++) {
+        const int begin = ring_begin[i];
+        const int end = ring_begin[i+1];
+        if( locked[i] || begin == end ) continue; ///< isolated vertices stay put
+
+        Vec3 q(0,0,0);
+        for(int j = begin; j < end; j++)
+            q += p_in[ ring[j] ];
+        q /= (Scalar) (end - begin);
+
+        if(on_tangent)
+            p_out[i] = q + (dot(n_in[i], Vec3(p_in[i] - q)) * n_in[i]);
+        else
+            p_out[i] = q;
     }
 
-    mesh->remove_vertex_property(q);
+    points.vector().swap(p_out);
 }
 
 Vec3 IsotropicRemesher::findNearestPoint(SurfaceMesh& original_mesh, const Vec3& _point, SurfaceMesh::Face& _fh, Scalar& /*=*/ _dbest) {
@@ -482,7 +532,7 @@ Vec3 IsotropicRemesher::findNearestPoint(SurfaceMesh& original_mesh, const Vec3&
         Vec3 ptn = _point;
 
         //SurfaceMesh::Scalar d = distPointTriangleSquared( _point, pt0, pt1, pt2, ptn );
-        Scalar d = ClosestPointTriangle( _point, pt0, pt1, pt2, ptn );
+        Scalar d = closest_point_triangle( _point, pt0, pt1, pt2, ptn );
 
         if( d < d_best) {
             d_best = d;
@@ -528,8 +578,16 @@ void IsotropicRemesher::projectToSurface() {
 
 void IsotropicRemesher::execute(){
     *myout << __FUNCTION__ << std::endl;
+    stats = IsotropicRemesherStats();
+    tic(t_execute);
+    
+    tic(t_analyze);
     phase_analyze();
+    stats.analyze_ms = toc(t_analyze);
+    
     phase_remesh();
+    stats.total_ms = toc(t_execute);
+    stats.peak_memory_bytes = peak_memory_bytes();
 }
 
 void IsotropicRemesher::phase_analyze(){
@@ -543,6 +601,10 @@ void IsotropicRemesher::phase_analyze(){
             efeature[e] = true;
     }
     
+    ///--- Per-vertex target edge lengths
+    if(adaptive)
+        computeSizingField();
+
     ///--- Mark short edges as features
     if(keep_short_edges){
         for(SurfaceMesh::Edge e: mesh->edges()) {
@@ -551,7 +613,7 @@ void IsotropicRemesher::phase_analyze(){
             const SurfaceMesh::Vertex & v1 = mesh->to_vertex(hh);
             const Vec3 vec = points[v1] - points[v0];
 
-            if (vec.norm() <= longest_edge_length)
+            if (vec.norm() <= targetLength(v0, v1))
                 efeature[e] = true;
         }
     }
@@ -566,19 +628,59 @@ void IsotropicRemesher::phase_analyze(){
 }
 
 void IsotropicRemesher::phase_remesh(){
-    const Scalar low  = (4.0 / 5.0) * longest_edge_length;
-    const Scalar high = (4.0 / 3.0) * longest_edge_length;
+    const int n_phases = reproject_to_surface ? 5 : 4;
+    int n_done = 0;
     
     for(int i = 0; i < num_iterations; i++) {
         *myout << "---------------------------------------------" << std::endl;
         *myout << "Iteration: " << (i+1) << "/" << num_iterations <<
                   " on mesh with #vertices: " << mesh->n_vertices() << std::endl;
-        splitLongEdges(high);
-        collapseShortEdges(low, high, keep_short_edges);
-        equalizeValences();
+        
+        IsotropicRemesherIteration it;
+        tic(t_iteration);
+        
+        /// records the iteration and reports progress, true if the user cancelled
+        auto finish_phase = [&](bool last){
+            n_done++;
+            bool cancel = progress && !progress( Scalar(n_done) / (num_iterations * n_phases) );
+            if(last || cancel){
+                it.n_vertices = mesh->n_vertices();
+                it.total_ms = toc(t_iteration);
+                stats.iterations.push_back(it);
+            }
+            if(cancel){
+                *myout << "cancelled" << std::endl;
+                stats.cancelled = true;
+            }
+            return cancel;
+        };
+        
+        tic(t_split);
+        it.n_splits = splitLongEdges();
+        it.split_ms = toc(t_split);
+        if(finish_phase(false)) return;
+        
+        tic(t_collapse);
+        it.n_collapses = collapseShortEdges(keep_short_edges);
+        it.collapse_ms = toc(t_collapse);
+        if(finish_phase(false)) return;
+        
+        tic(t_flip);
+        it.n_flips = equalizeValences();
+        it.flip_ms = toc(t_flip);
+        if(finish_phase(false)) return;
+        
+        tic(t_relax);
         tangentialRelaxation();
-        if(reproject_to_surface)
+        it.relax_ms = toc(t_relax);
+        if(finish_phase(!reproject_to_surface)) return;
+        
+        if(reproject_to_surface){
+            tic(t_project);
             projectToSurface();
+            it.project_ms = toc(t_project);
+            if(finish_phase(true)) return;
+        }
     }
 }
 
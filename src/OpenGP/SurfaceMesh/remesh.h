@@ -1,4 +1,7 @@
 #pragma once
+#include <vector>
+#include <string>
+#include <functional>
 #include <OpenGP/headeronly.h>
 #include <OpenGP/types.h>
 #include <OpenGP/NullStream.h>
@@ -15,6 +18,31 @@ namespace OpenGP{
 
 
 
+/// Wall time (ms) and element counts of a single remeshing iteration
+struct IsotropicRemesherIteration{
+    int n_vertices = 0;       ///< #vertices at the end of the iteration
+    int n_splits = 0;
+    int n_collapses = 0;
+    int n_flips = 0;
+    double split_ms = 0;
+    double collapse_ms = 0;
+    double flip_ms = 0;
+    double relax_ms = 0;
+    double project_ms = 0;
+    double total_ms = 0;
+};
+
+/// Instrumentation collected by IsotropicRemesher::execute()
+struct IsotropicRemesherStats{
+    double analyze_ms = 0;
+    double total_ms = 0;
+    size_t peak_memory_bytes = 0; ///< peak resident set size of the process (0 if unsupported)
+    bool cancelled = false;       ///< was the run interrupted by the progress callback?
+    std::vector<IsotropicRemesherIteration> iterations;
+    /// Serializes the statistics as a JSON object
+    HEADERONLY_INLINE std::string to_json() const;
+};
+
 class IsotropicRemesher{
     /// @{ @todo centralize these definitions elsewhere
     const std::string VPOINT = "v:point";           ///< vertex coordinates
@@ -22,6 +50,7 @@ class IsotropicRemesher{
     const std::string VCOLOR = "v:color";           ///< vertex color
     const std::string VAREA = "v:area";             ///< vertex areas
     const std::string VQUALITY = "v:quality";       ///< vertex quality
+    const std::string VSIZING = "v:sizing";         ///< vertex target edge length
     const std::string FNORMAL = "f:normal";         ///< face normals
     const std::string FAREA = "f:area";             ///< face area
     const std::string ELENGTH = "e:length";         ///< edge length
@@ -31,6 +60,8 @@ class IsotropicRemesher{
 private:
     SurfaceMesh::Vertex_property<Vec3> points;
     SurfaceMesh::Edge_property<bool> efeature;
+    SurfaceMesh::Vertex_property<Scalar> vsizing;
+    bool owns_sizing = false;
     SurfaceMesh* mesh = NULL;
     SurfaceMesh copy;
 public:
@@ -52,6 +83,8 @@ public:
     }
     ~IsotropicRemesher(){
         mesh->remove_edge_property(efeature);
+        if(owns_sizing)
+            mesh->remove_vertex_property(vsizing);
     }
    
 /// @{ core methods
@@ -74,6 +107,14 @@ public:
     Scalar num_iterations = 10;
     /// What's the largest admissible edge?
     Scalar longest_edge_length = nan();
+    /// Should the target edge length follow a per-vertex sizing field? The field
+    /// is read from the "v:sizing" vertex property (Scalar) when the mesh has one,
+    /// otherwise it is computed from the discrete curvature.
+    bool adaptive = false;
+    /// Adaptive: what's the shortest admissible edge? (default: 10% of longest_edge_length)
+    Scalar shortest_edge_length = nan();
+    /// Adaptive: how far may an edge deviate from the curved surface? (default: 5% of longest_edge_length)
+    Scalar approximation_error = nan();
     /// Should I mark short edges as features?
     bool keep_short_edges = false;
     /// After tangentially relaxing vertices, should I reproject vertices on the tangent space
@@ -81,6 +122,13 @@ public:
     bool reproject_on_tanget = true;
     /// After tangentially relaxing vertices, should I project on the original surface (slow, query an AABB search tree)
     bool reproject_to_surface = false;     
+    /// Called after every phase with the overall progress in [0,1]; return false to cancel the run
+    std::function<bool(Scalar)> progress;
+/// @}
+
+/// @{ instrumentation (filled by execute)
+public:
+    IsotropicRemesherStats stats;
 /// @}
     
 #ifdef WITH_CGAL
@@ -90,9 +138,11 @@ private:
     
 /// @{ utilities
 private:
-    void splitLongEdges(Scalar maxEdgeLength);
-    void collapseShortEdges(const Scalar _minEdgeLength, const Scalar _maxEdgeLength, bool keep_short_edges);
-    void equalizeValences();
+    void computeSizingField();
+    Scalar targetLength(const SurfaceMesh::Vertex& v0, const SurfaceMesh::Vertex& v1);
+    int splitLongEdges();
+    int collapseShortEdges(bool keep_short_edges);
+    int equalizeValences();
     void tangentialRelaxation();
     void projectToSurface();
     int targetValence(const SurfaceMesh::Vertex &_vh);
@@ -0,0 +1,216 @@
+#include "sampling.h"
+#include <OpenGP/MLogger.h>
+#include <OpenGP/PointCloud/HashGrid3.h>
+#include <random>
+#include <cmath>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// Walker/Vose alias table: O(1) sampling of a discrete distribution
+struct AliasTable{
+    std::vector<Scalar> prob;
+    std::vector<int> alias;
+
+    AliasTable(const std::vector<double>& weights){
+        int n = (int) weights.size();
+        prob.resize(n);
+        alias.resize(n);
+        double total = 0;
+        for(double w: weights) total += w;
+        std::vector<double> scaled(n);
+        std::vector<int> small, large;
+        for(int i=0; i<n; ++i){
+            scaled[i] = weights[i] * n / total;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+        while(!small.empty() && !large.empty()){
+            int s = small.back(); small.pop_back();
+            int l = large.back(); large.pop_back();
+            prob[s] = Scalar(scaled[s]);
+            alias[s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1;
+            (scaled[l] < 1 ? small : large).push_back(l);
+        }
+        for(int i: large){ prob[i] = 1; alias[i] = i; }
+        for(int i: small){ prob[i] = 1; alias[i] = i; } ///< round-off leftovers
+    }
+
+    int operator()(Scalar u1, Scalar u2) const{
+        int i = std::min(int(u1*prob.size()), int(prob.size())-1);
+        return (u2 < prob[i]) ? i : alias[i];
+    }
+};
+
+/// Area weighted samples, written to columns [0, n) of the output
+inline void sample_area_weighted(const SurfaceMesh& mesh, int n, unsigned int seed, SurfaceSamples& S){
+    auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+    auto vnormals = mesh.get_vertex_property<Vec3>("v:normal");
+
+    ///--- triangle corners by face index (deleted faces get zero area)
+    int nf = mesh.faces_size();
+    std::vector<int> corners(3*nf, 0);
+    std::vector<double> areas(nf, 0);
+    for(auto f: mesh.faces()){
+        int k = 0;
+        for(auto v: mesh.vertices(f))
+            corners[3*f.idx()+(k++)] = v.idx();
+        const Vec3& a = vpoints.vector()[corners[3*f.idx()]];
+        const Vec3& b = vpoints.vector()[corners[3*f.idx()+1]];
+        const Vec3& c = vpoints.vector()[corners[3*f.idx()+2]];
+        areas[f.idx()] = 0.5 * (b-a).cross(c-a).norm();
+    }
+    AliasTable table(areas);
+
+    S.positions.resize(3, n);
+    S.normals.resize(3, n);
+    S.barycentrics.resize(3, n);
+    S.faces.resize(n);
+
+    const int block = 4096;
+    int n_blocks = (n+block-1)/block;
+    #pragma omp parallel for schedule(dynamic)
+    for(int bi=0; bi<n_blocks; ++bi){
+        std::mt19937 rng(seed*2654435761u + bi);
+        std::uniform_real_distribution<Scalar> U(0, 1);
+        for(int i=bi*block; i<std::min(n, (bi+1)*block); ++i){
+            Scalar u1 = U(rng), u2 = U(rng), r1 = std::sqrt(U(rng)), r2 = U(rng);
+            int f = table(u1, u2);
+            Vec3 w(1-r1, r1*(1-r2), r1*r2);
+            const Vec3& a = vpoints.vector()[corners[3*f]];
+            const Vec3& b = vpoints.vector()[corners[3*f+1]];
+            const Vec3& c = vpoints.vector()[corners[3*f+2]];
+            S.positions.col(i) = w[0]*a + w[1]*b + w[2]*c;
+            if(vnormals)
+                S.normals.col(i) = (w[0]*vnormals.vector()[corners[3*f]] + w[1]*vnormals.vector()[corners[3*f+1]]
+                                  + w[2]*vnormals.vector()[corners[3*f+2]]).normalized();
+            else
+                S.normals.col(i) = (b-a).cross(c-a).normalized();
+            S.barycentrics.col(i) = w;
+            S.faces[i] = f;
+        }
+    }
+}
+
+/// Keeps the \c n samples of \c C that best cover the surface (weighted sample elimination)
+inline void eliminate_samples(const SurfaceSamples& C, int n, Scalar area, SurfaceSamples& S){
+    int m = C.size();
+    ///--- maximum radius of n samples on a surface of the given area (hexagonal packing)
+    Scalar r_max = std::sqrt(area / (2*std::sqrt(Scalar(3))*n));
+    Scalar r2 = 2*r_max;
+    HashGrid3 grid(C.positions, r2);
+    std::vector<int> offsets, neighbors;
+    std::vector<Scalar> sqdists;
+    grid.radius(C.positions, r2, offsets, neighbors, sqdists);
+
+    auto weight = [&](Scalar d2){
+        Scalar x = 1 - std::sqrt(d2)/r2;
+        x *= x; x *= x;
+        return x*x; ///< (1-d/2r)^8
+    };
+    std::vector<Scalar> w(m, 0);
+    #pragma omp parallel for
+    for(int i=0; i<m; ++i)
+        for(int e=offsets[i]; e<offsets[i+1]; ++e)
+            if(neighbors[e]!=i) w[i] += weight(sqdists[e]);
+
+    ///--- indexed max-heap on the weights, neighbor weights only decrease
+    std::vector<int> heap(m), pos(m);
+    for(int i=0; i<m; ++i){ heap[i] = i; pos[i] = i; }
+    int size = m;
+    auto swap_nodes = [&](int a, int b){
+        std::swap(heap[a], heap[b]);
+        pos[heap[a]] = a;
+        pos[heap[b]] = b;
+    };
+    auto sift_down = [&](int k){
+        while(true){
+            int l = 2*k+1, r = l+1, largest = k;
+            if(l<size && w[heap[l]] > w[heap[largest]]) largest = l;
+            if(r<size && w[heap[r]] > w[heap[largest]]) largest = r;
+            if(largest==k) return;
+            swap_nodes(k, largest);
+            k = largest;
+        }
+    };
+    for(int k=size/2-1; k>=0; --k)
+        sift_down(k);
+
+    ///--- remove the most crowded sample until n are left
+    std::vector<char> removed(m, 0);
+    int left = m;
+    while(left > n){
+        int i = heap[0];
+        swap_nodes(0, --size);
+        sift_down(0);
+        removed[i] = 1;
+        --left;
+        for(int e=offsets[i]; e<offsets[i+1]; ++e){
+            int j = neighbors[e];
+            if(j==i || removed[j]) continue;
+            w[j] -= weight(sqdists[e]);
+            sift_down(pos[j]);
+        }
+    }
+
+    S.positions.resize(3, left);
+    S.normals.resize(3, left);
+    S.barycentrics.resize(3, left);
+    S.faces.resize(left);
+    for(int i=0, k=0; i<m; ++i){
+        if(removed[i]) continue;
+        S.positions.col(k) = C.positions.col(i);
+        S.normals.col(k) = C.normals.col(i);
+        S.barycentrics.col(k) = C.barycentrics.col(i);
+        S.faces[k] = C.faces[i];
+        ++k;
+    }
+}
+
+} // internal
+
+SurfaceSamples sample_surface(const SurfaceMesh& mesh, int n, SamplingMode mode, unsigned int seed){
+    CHECK(mesh.is_triangle_mesh());
+    SurfaceSamples S;
+    if(n<=0 || mesh.n_faces()==0) return S;
+
+    if(mode == SAMPLE_AREA_WEIGHTED){
+        internal::sample_area_weighted(mesh, n, seed, S);
+    } else {
+        SurfaceSamples candidates;
+        internal::sample_area_weighted(mesh, 5*n, seed, candidates);
+        auto vpoints = mesh.get_vertex_property<Vec3>("v:point");
+        Scalar area = 0;
+        for(auto f: mesh.faces()){
+            auto fv = mesh.vertices(f);
+            Vec3 a = vpoints[*fv]; ++fv;
+            Vec3 b = vpoints[*fv]; ++fv;
+            Vec3 c = vpoints[*fv];
+            area += 0.5 * (b-a).cross(c-a).norm();
+        }
+        internal::eliminate_samples(candidates, n, area, S);
+    }
+    return S;
+}
+
+SurfaceMesh SurfaceSamples::to_cloud() const{
+    SurfaceMesh cloud;
+    cloud.reserve(size(), 0, 0);
+    auto vnormals = cloud.add_vertex_property<Vec3>("v:normal");
+    auto vface = cloud.add_vertex_property<int>("v:face");
+    auto vbary = cloud.add_vertex_property<Vec3>("v:barycentric");
+    for(int i=0; i<size(); ++i){
+        SurfaceMesh::Vertex v = cloud.add_vertex(positions.col(i));
+        vnormals[v] = normals.col(i);
+        vface[v] = faces[i];
+        vbary[v] = barycentrics.col(i);
+    }
+    return cloud;
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
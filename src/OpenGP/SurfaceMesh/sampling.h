@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+enum SamplingMode{
+    SAMPLE_AREA_WEIGHTED, ///< independent samples, uniform w.r.t. surface area
+    SAMPLE_POISSON_DISK,  ///< blue noise, by sample elimination (Yuksel '15) of 5n area weighted samples
+};
+
+/// Points on a triangle mesh, sample i lies in face faces[i] at barycentric
+/// coordinates barycentrics.col(i) w.r.t. the face vertices in circulation order
+struct SurfaceSamples{
+    Mat3xN positions;
+    Mat3xN normals;      ///< interpolated "v:normal" if available, face normal otherwise
+    Mat3xN barycentrics;
+    std::vector<int> faces;
+
+    int size() const { return (int) positions.cols(); }
+    /// point-only mesh with "v:normal", "v:face" (int) and "v:barycentric" properties
+    HEADERONLY_INLINE SurfaceMesh to_cloud() const;
+};
+
+/// Samples \c n points on the surface of a triangle mesh. Results only depend on
+/// \c seed (not on the number of threads): random numbers are drawn per fixed size
+/// block of samples.
+HEADERONLY_INLINE SurfaceSamples sample_surface(const SurfaceMesh& mesh, int n, SamplingMode mode=SAMPLE_AREA_WEIGHTED, unsigned int seed=0);
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "sampling.cpp"
+#endif
@@ -0,0 +1,145 @@
+#include "smoothing.h"
+#include <OpenGP/MLogger.h>
+#include <OpenGP/SurfaceMesh/Laplacian.h>
+#include <vector>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+
+/// Restricts A X = B to the unknowns with index[i] >= 0 (their position in the
+/// reduced system): Aff = A(free, free), Bf = B(free) - A(free, fixed) X(fixed).
+/// Columns are extracted in parallel from the counts of their free rows.
+inline void restrict_system(const SparseMatrixd& A, const Eigen::MatrixXd& B, const Eigen::MatrixXd& X,
+                            const std::vector<int>& index, int n_free, SparseMatrixd& Aff, Eigen::MatrixXd& Bf){
+    int n = (int) A.cols(), k = (int) B.cols();
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* values = A.valuePtr();
+
+    std::vector<int> columns(n_free);
+    for(int i=0; i<n; ++i)
+        if(index[i] >= 0) columns[index[i]] = i;
+
+    Aff.resize(n_free, n_free);
+    std::vector<int> counts(n_free+1, 0);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int c=0; c<n_free; ++c)
+        for(int e=outer[columns[c]]; e<outer[columns[c]+1]; ++e)
+            counts[c+1] += (index[inner[e]] >= 0);
+    for(int c=0; c<n_free; ++c)
+        counts[c+1] += counts[c];
+    Aff.resizeNonZeros(counts[n_free]);
+    std::copy(counts.begin(), counts.end(), Aff.outerIndexPtr());
+
+    Bf.resize(n_free, k);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(int c=0; c<n_free; ++c){
+        int i = columns[c], out = counts[c];
+        Bf.row(c) = B.row(i);
+        ///--- symmetric: column i holds row i
+        for(int e=outer[i]; e<outer[i+1]; ++e){
+            int r = index[inner[e]];
+            if(r >= 0){
+                Aff.innerIndexPtr()[out] = r;
+                Aff.valuePtr()[out++] = values[e];
+            } else {
+                Bf.row(c) -= values[e] * X.row(inner[e]);
+            }
+        }
+    }
+}
+
+} // internal
+
+int implicit_smoothing(SurfaceMesh& mesh, Scalar time_factor, int iterations){
+    CHECK(mesh.is_triangle_mesh());
+    auto vpoints = mesh.vertex_property<Vec3>("v:point");
+    SurfaceMeshLaplacian operators(mesh);
+    int n = mesh.n_vertices();
+
+    std::vector<int> index(n, -1);
+    int n_free = 0;
+    for(auto v: mesh.vertices())
+        if(!mesh.is_boundary(v) && !mesh.is_isolated(v))
+            index[v.idx()] = n_free++;
+
+    Eigen::MatrixXd X(n, 3);
+    for(auto v: mesh.vertices())
+        X.row(v.idx()) = vpoints[v].cast<double>().transpose();
+
+    int total = 0;
+    SparseMatrixd L, M, A, Aff;
+    Eigen::MatrixXd B, Bf, Xf(n_free, 3);
+    for(int iteration=0; iteration<iterations; ++iteration){
+        double mean_edge = 0;
+        for(auto e: mesh.edges())
+            mean_edge += (X.row(mesh.vertex(e,0).idx()) - X.row(mesh.vertex(e,1).idx())).norm();
+        mean_edge /= std::max(mesh.n_edges(), (unsigned int) 1);
+        double t = time_factor * mean_edge * mean_edge;
+
+        operators.laplacian(L, LAPLACIAN_COTAN);
+        operators.mass(M, MASS_LUMPED);
+        ///--- same pattern as L: M - tL is computed in place on its values
+        A = L;
+        for(int i=0; i<A.nonZeros(); ++i)
+            A.valuePtr()[i] *= -t;
+        for(auto v: mesh.vertices())
+            A.valuePtr()[operators.diagonal(v)] += M.valuePtr()[v.idx()];
+        B = M.diagonal().asDiagonal() * X;
+
+        internal::restrict_system(A, B, X, index, n_free, Aff, Bf);
+        for(int i=0; i<n; ++i)
+            if(index[i] >= 0) Xf.row(index[i]) = X.row(i);
+        total += pcg_solve(Aff, Bf, Xf, 1e-8);
+        for(int i=0; i<n; ++i)
+            if(index[i] >= 0) X.row(i) = Xf.row(index[i]);
+        for(auto v: mesh.vertices())
+            vpoints[v] = X.row(v.idx()).transpose().cast<Scalar>();
+    }
+    return total;
+}
+
+int fair(SurfaceMesh& mesh, const std::string& selection){
+    CHECK(mesh.is_triangle_mesh());
+    auto vpoints = mesh.vertex_property<Vec3>("v:point");
+    auto vselected = mesh.get_vertex_property<bool>(selection);
+    CHECK(vselected);
+    SurfaceMeshLaplacian operators(mesh);
+    int n = mesh.n_vertices();
+
+    std::vector<int> index(n, -1);
+    int n_free = 0;
+    for(auto v: mesh.vertices())
+        if(vselected[v] && !mesh.is_boundary(v) && !mesh.is_isolated(v))
+            index[v.idx()] = n_free++;
+    if(n_free == 0) return 0;
+
+    SparseMatrixd L, M, A, Aff;
+    operators.laplacian(L, LAPLACIAN_COTAN);
+    operators.mass(M, MASS_LUMPED);
+    Eigen::VectorXd inv_mass = M.diagonal();
+    for(int i=0; i<n; ++i)
+        inv_mass[i] = (inv_mass[i] > 0) ? 1/inv_mass[i] : 0;
+    A = L * inv_mass.asDiagonal() * L;
+    A.makeCompressed();
+
+    Eigen::MatrixXd X(n, 3), B = Eigen::MatrixXd::Zero(n, 3), Bf, Xf(n_free, 3);
+    for(auto v: mesh.vertices())
+        X.row(v.idx()) = vpoints[v].cast<double>().transpose();
+    internal::restrict_system(A, B, X, index, n_free, Aff, Bf);
+    for(int i=0; i<n; ++i)
+        if(index[i] >= 0) Xf.row(index[i]) = X.row(i);
+    int iterations = pcg_solve(Aff, Bf, Xf, 1e-8, 10*n_free);
+    for(auto v: mesh.vertices())
+        if(index[v.idx()] >= 0)
+            vpoints[v] = Xf.row(index[v.idx()]).transpose().cast<Scalar>();
+    return iterations;
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
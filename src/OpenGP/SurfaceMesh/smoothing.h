@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+#include <OpenGP/SurfaceMesh/SurfaceMesh.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Implicit (backward Euler) smoothing with the cotan Laplacian (Desbrun et al.
+/// '99): (M - tL) X = M X0 with t = time_factor * (mean edge length)^2, so a time
+/// factor of k damps about as much as k explicit umbrella steps. Operators are
+/// rebuilt from the current shape at each of the \c iterations; the x, y, z
+/// systems are solved together with conjugate gradients warm-started from the
+/// current positions. Boundary vertices stay fixed. Returns the total number of
+/// solver iterations.
+HEADERONLY_INLINE int implicit_smoothing(SurfaceMesh& mesh, Scalar time_factor, int iterations=1);
+
+/// Bilaplacian fairing: the vertices flagged in the bool vertex property
+/// \c selection are moved to minimize the thin plate energy, L M^-1 L X = 0, the
+/// others (and the boundary) stay fixed as constraints. Conjugate gradients start
+/// from the current positions. The cotan weights are those of the current shape,
+/// very noisy regions may need a second pass. Returns the number of solver iterations.
+HEADERONLY_INLINE int fair(SurfaceMesh& mesh, const std::string& selection="v:selected");
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "smoothing.cpp"
+#endif
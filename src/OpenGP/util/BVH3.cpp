@@ -0,0 +1,193 @@
+#include "BVH3.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+namespace internal{
+    /// half surface area, the SAH only compares ratios
+    inline Scalar bvh_area(const Box3& box){
+        if(box.isEmpty()) return 0;
+        Vec3 d = box.diagonal();
+        return d.x()*d.y() + d.y()*d.z() + d.z()*d.x();
+    }
+}
+
+void BVH3::build(const std::vector<Box3>& boxes, int leaf_size){
+    const int n_bins = 12;
+    int n = (int) boxes.size();
+    nodes_.clear();
+    primitives_.resize(n);
+    for(int i=0; i<n; ++i) primitives_[i] = i;
+    level_begin_.clear();
+    level_nodes_.clear();
+    leaf_size_ = leaf_size;
+    build_cost_ = cost_ = 0;
+    if(n==0) return;
+    nodes_.reserve(2*(n/std::max(leaf_size,1))+1);
+
+    std::vector<Vec3> centers(n);
+    for(int i=0; i<n; ++i)
+        centers[i] = boxes[i].center();
+
+    ///--- top-down construction, explicit stack of (node, begin, end)
+    struct Task{ int node, begin, end; };
+    std::vector<Task> stack;
+    nodes_.push_back(Node());
+    stack.push_back({0, 0, n});
+    while(!stack.empty()){
+        Task task = stack.back();
+        stack.pop_back();
+        Box3 box, cbox;
+        box.setEmpty();
+        cbox.setEmpty();
+        for(int i=task.begin; i<task.end; ++i){
+            box.extend(boxes[primitives_[i]]);
+            cbox.extend(centers[primitives_[i]]);
+        }
+        nodes_[task.node].box = box;
+        int count = task.end - task.begin;
+
+        ///--- binned SAH along the largest extent of the centroids
+        int axis;
+        Scalar extent = cbox.diagonal().maxCoeff(&axis);
+        int split = -1;
+        if(count > leaf_size && extent > 0){
+            Box3 bin_box[n_bins];
+            int bin_count[n_bins] = {0};
+            for(int b=0; b<n_bins; ++b) bin_box[b].setEmpty();
+            Scalar scale = n_bins / extent;
+            auto bin_of = [&](int p){
+                return std::min(n_bins-1, int((centers[p][axis]-cbox.min()[axis])*scale));
+            };
+            for(int i=task.begin; i<task.end; ++i){
+                int b = bin_of(primitives_[i]);
+                bin_box[b].extend(boxes[primitives_[i]]);
+                ++bin_count[b];
+            }
+            Scalar right_area[n_bins];
+            int right_count[n_bins];
+            Box3 acc;
+            acc.setEmpty();
+            int c = 0;
+            for(int b=n_bins-1; b>0; --b){
+                acc.extend(bin_box[b]);
+                c += bin_count[b];
+                right_area[b] = internal::bvh_area(acc);
+                right_count[b] = c;
+            }
+            Scalar best = count * internal::bvh_area(box); ///< cost of a leaf
+            acc.setEmpty();
+            c = 0;
+            for(int b=0; b<n_bins-1; ++b){
+                acc.extend(bin_box[b]);
+                c += bin_count[b];
+                Scalar cost = c*internal::bvh_area(acc) + right_count[b+1]*right_area[b+1];
+                if(c>0 && right_count[b+1]>0 && cost < best){
+                    best = cost;
+                    split = b;
+                }
+            }
+            ///--- too many primitives for a leaf: fall back to a median split
+            if(split<0 && count > 4*leaf_size){
+                int mid = (task.begin + task.end)/2;
+                std::nth_element(primitives_.begin()+task.begin, primitives_.begin()+mid, primitives_.begin()+task.end,
+                                 [&](int a, int b){ return centers[a][axis] < centers[b][axis]; });
+                int left = (int) nodes_.size();
+                nodes_[task.node].first = left;
+                nodes_[task.node].count = 0;
+                nodes_.push_back(Node());
+                nodes_.push_back(Node());
+                stack.push_back({left, task.begin, mid});
+                stack.push_back({left+1, mid, task.end});
+                continue;
+            }
+            if(split>=0){
+                int* mid = std::partition(primitives_.data()+task.begin, primitives_.data()+task.end,
+                                          [&](int p){ return bin_of(p) <= split; });
+                int m = int(mid - primitives_.data());
+                int left = (int) nodes_.size();
+                nodes_[task.node].first = left;
+                nodes_[task.node].count = 0;
+                nodes_.push_back(Node());
+                nodes_.push_back(Node());
+                stack.push_back({left, task.begin, m});
+                stack.push_back({left+1, m, task.end});
+                continue;
+            }
+        }
+        ///--- leaf
+        nodes_[task.node].first = task.begin;
+        nodes_[task.node].count = count;
+    }
+
+    ///--- depth of each node (children come after their parent), grouped by a counting sort
+    int n_nodes = (int) nodes_.size();
+    std::vector<int> depth(n_nodes, 0);
+    int max_depth = 0;
+    for(int k=0; k<n_nodes; ++k){
+        if(nodes_[k].is_leaf()) continue;
+        depth[nodes_[k].first] = depth[nodes_[k].first+1] = depth[k]+1;
+        max_depth = std::max(max_depth, depth[k]+1);
+    }
+    level_begin_.assign(max_depth+2, 0);
+    for(int k=0; k<n_nodes; ++k)
+        ++level_begin_[depth[k]+1];
+    for(int l=0; l<=max_depth; ++l)
+        level_begin_[l+1] += level_begin_[l];
+    level_nodes_.resize(n_nodes);
+    std::vector<int> offset(level_begin_.begin(), level_begin_.end()-1);
+    for(int k=0; k<n_nodes; ++k)
+        level_nodes_[offset[depth[k]]++] = k;
+
+    build_cost_ = cost_ = compute_cost();
+}
+
+void BVH3::refit(const std::vector<Box3>& boxes){
+    CHECK(boxes.size() == primitives_.size());
+    for(int l=(int) level_begin_.size()-2; l>=0; --l){
+        int begin = level_begin_[l], end = level_begin_[l+1];
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int k=begin; k<end; ++k){
+            Node& node = nodes_[level_nodes_[k]];
+            Box3 box;
+            box.setEmpty();
+            if(node.is_leaf()){
+                for(int i=node.first; i<node.first+node.count; ++i)
+                    box.extend(boxes[primitives_[i]]);
+            } else {
+                box.extend(nodes_[node.first].box);
+                box.extend(nodes_[node.first+1].box);
+            }
+            node.box = box;
+        }
+    }
+    cost_ = compute_cost();
+}
+
+bool BVH3::update(const std::vector<Box3>& boxes, Scalar max_degradation){
+    if(boxes.size() == primitives_.size() && !nodes_.empty()){
+        refit(boxes);
+        if(degradation() <= max_degradation) return false;
+    }
+    build(boxes, leaf_size_);
+    return true;
+}
+
+Scalar BVH3::compute_cost() const{
+    if(nodes_.empty()) return 0;
+    Scalar root = internal::bvh_area(nodes_[0].box);
+    if(root <= 0) return 0;
+    double sum = 0;
+    int n = (int) nodes_.size();
+    #pragma omp parallel for reduction(+:sum)
+    for(int k=0; k<n; ++k)
+        sum += internal::bvh_area(nodes_[k].box) * (nodes_[k].is_leaf() ? nodes_[k].count : 1);
+    return Scalar(sum / root);
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
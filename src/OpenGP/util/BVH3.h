@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Bounding volume hierarchy over axis aligned boxes, stored as a flat array of
+/// nodes (root at 0, the two children of an inner node are consecutive). Built top
+/// down with a binned surface area heuristic. Primitives are only known through
+/// their boxes: intersection tests are left to the caller.
+class BVH3{
+public:
+    struct Node{
+        Box3 box;
+        int first;  ///< leaf: first entry in primitives(), inner: index of the left child
+        int count;  ///< leaf: number of primitives, inner: 0
+        bool is_leaf() const { return count > 0; }
+    };
+
+    /// builds the hierarchy over \c boxes (primitive i has box i)
+    HEADERONLY_INLINE void build(const std::vector<Box3>& boxes, int leaf_size=4);
+    /// Updates the node boxes after the primitives moved (same primitives, new
+    /// boxes), keeping the tree: bottom-up, one parallel pass per tree level.
+    HEADERONLY_INLINE void refit(const std::vector<Box3>& boxes);
+    /// refit(), or build() when the refitted tree costs more than \c max_degradation
+    /// times its cost after the last build. Returns true if it was rebuilt (primitives()
+    /// changed order).
+    HEADERONLY_INLINE bool update(const std::vector<Box3>& boxes, Scalar max_degradation=2);
+
+    /// Surface area heuristic cost of the tree (expected number of node visits and
+    /// primitive tests for a random ray, in units of the root box), measured at the
+    /// last build() or refit(); rigid motions and scaling leave it unchanged.
+    Scalar sah_cost() const { return cost_; }
+    /// sah_cost() relative to its value after the last build(), grows as refits degrade the tree
+    Scalar degradation() const { return (build_cost_ > 0) ? cost_/build_cost_ : 1; }
+
+    bool empty() const { return nodes_.empty(); }
+    const std::vector<Node>& nodes() const { return nodes_; }
+    /// primitive indices, leaves reference contiguous ranges
+    const std::vector<int>& primitives() const { return primitives_; }
+
+private:
+    HEADERONLY_INLINE Scalar compute_cost() const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<int> primitives_;
+    std::vector<int> level_begin_, level_nodes_; ///< nodes grouped by depth, for refit()
+    int leaf_size_ = 4;
+    Scalar build_cost_ = 0, cost_ = 0;
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "BVH3.cpp"
+#endif
@@ -0,0 +1,54 @@
+#include "SparseGrid3.h"
+#include <OpenGP/MLogger.h>
+#include <algorithm>
+
+//=============================================================================
+namespace OpenGP {
+//=============================================================================
+
+SparseGrid3::SparseGrid3(const Box3& box, const Eigen::Vector3i& resolution, Scalar background, int brick_size)
+    : box_(box), resolution_(resolution), brick_size_(brick_size){
+    CHECK(brick_size > 0);
+    n_bricks_ = (resolution.array() + brick_size-1) / brick_size;
+    constant_.assign(n_bricks_.prod(), background);
+    data_.resize(n_bricks_.prod());
+}
+
+void SparseGrid3::insert(const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Scalar* values){
+    const int B = brick_size_;
+    CHECK(origin.x()%B==0 && origin.y()%B==0 && origin.z()%B==0);
+    CHECK((size.array() <= B).all());
+    Eigen::Vector3i c = origin / B;
+    int b = c.x() + n_bricks_.x()*(c.y() + n_bricks_.y()*c.z());
+
+    int n = size.prod();
+    bool constant = true;
+    for(int i=1; i<n && constant; ++i)
+        constant = (values[i] == values[0]);
+    if(constant){
+        constant_[b] = values[0];
+        std::vector<Scalar>().swap(data_[b]);
+        return;
+    }
+
+    ///--- partial bricks at the upper faces of the grid are padded with their last sample
+    std::vector<Scalar>& data = data_[b];
+    data.resize(B*B*B);
+    for(int z=0; z<B; ++z)
+        for(int y=0; y<B; ++y)
+            for(int x=0; x<B; ++x){
+                int sx = std::min(x, size.x()-1), sy = std::min(y, size.y()-1), sz = std::min(z, size.z()-1);
+                data[x + B*(y + B*z)] = values[sx + size.x()*(sy + size.y()*sz)];
+            }
+}
+
+Scalar SparseGrid3::value(int x, int y, int z) const{
+    const int B = brick_size_;
+    int b = x/B + n_bricks_.x()*(y/B + n_bricks_.y()*(z/B));
+    if(data_[b].empty()) return constant_[b];
+    return data_[b][x%B + B*(y%B + B*(z%B))];
+}
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <OpenGP/headeronly.h>
+#include <OpenGP/types.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Scalar samples on a regular grid spanning a box (sample (x,y,z) at the center
+/// of voxel (x,y,z), as in SignedDistance::voxelize), stored as cubic bricks. Only
+/// bricks with varying samples are allocated, the others keep a single value.
+class SparseGrid3{
+public:
+    /// all bricks start out constant, equal to \c background
+    HEADERONLY_INLINE SparseGrid3(const Box3& box, const Eigen::Vector3i& resolution, Scalar background, int brick_size=8);
+
+    /// stores a brick, \c origin must be a multiple of the brick size and \c values
+    /// hold size.prod() samples (x fastest). The signature matches BrickCallback (util/VoxelBricks.h):
+    /// distinct bricks can be inserted concurrently.
+    HEADERONLY_INLINE void insert(const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Scalar* values);
+
+    HEADERONLY_INLINE Scalar value(int x, int y, int z) const;
+
+    const Box3& box() const { return box_; }
+    const Eigen::Vector3i& resolution() const { return resolution_; }
+    int brick_size() const { return brick_size_; }
+    /// number of bricks along each axis, brick (x,y,z) has index x + nx*(y + ny*z)
+    const Eigen::Vector3i& bricks() const { return n_bricks_; }
+    /// true if all samples of the brick are brick_constant(b)
+    bool is_constant(int b) const { return data_[b].empty(); }
+    Scalar brick_constant(int b) const { return constant_[b]; }
+    /// samples of an allocated brick, brick_size()^3 values (x fastest)
+    const Scalar* brick_data(int b) const { return data_[b].data(); }
+
+private:
+    Box3 box_;
+    Eigen::Vector3i resolution_;
+    Eigen::Vector3i n_bricks_;
+    int brick_size_;
+    std::vector<Scalar> constant_;
+    std::vector<std::vector<Scalar>> data_;
+};
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
+
+#ifdef HEADERONLY
+    #include "SparseGrid3.cpp"
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <OpenGP/types.h>
+#include <OpenGP/MLogger.h>
+
+//=============================================================================
+namespace OpenGP{
+//=============================================================================
+
+/// Callback receiving a brick of a sampled grid: \c origin is its first voxel, \c size
+/// its extent in voxels, \c values its samples (x fastest). Called concurrently.
+/// SparseGrid3::insert() has this signature.
+typedef std::function<void(const Eigen::Vector3i& origin, const Eigen::Vector3i& size, const Scalar* values)> BrickCallback;
+
+namespace internal{
+
+/// Cubic bricks of a grid of \c resolution voxels spanning \c box, sample (x,y,z) at
+/// the center of voxel (x,y,z). Drives the brick by brick voxelization of distance
+/// fields (SignedDistance, SphereMeshDistance); bricks at the upper faces are partial.
+class VoxelBricks{
+public:
+    VoxelBricks(const Box3& box, const Eigen::Vector3i& resolution, int brick_size)
+        : box_(box), resolution_(resolution), brick_size_(brick_size){
+        CHECK(brick_size > 0);
+        h_ = box.diagonal().cwiseQuotient(resolution.cast<Scalar>());
+        n_bricks_ = (resolution.array() + brick_size-1) / brick_size;
+    }
+
+    /// voxel size
+    const Vec3& spacing() const { return h_; }
+    /// number of bricks along each axis, brick (x,y,z) has index x + nx*(y + ny*z)
+    const Eigen::Vector3i& bricks() const { return n_bricks_; }
+    int size() const { return n_bricks_.prod(); }
+
+    Vec3 center(int x, int y, int z) const {
+        return Vec3(box_.min() + h_.cwiseProduct(Vec3(x+0.5f, y+0.5f, z+0.5f)));
+    }
+
+    Eigen::Vector3i coords(int bi) const {
+        return Eigen::Vector3i(bi % n_bricks_.x(), (bi / n_bricks_.x()) % n_bricks_.y(), bi / (n_bricks_.x()*n_bricks_.y()));
+    }
+
+    /// first voxel and extent of brick \c bi, center and radius of the hull of its samples
+    void extent(int bi, Eigen::Vector3i& origin, Eigen::Vector3i& size, Vec3& mid, Scalar& radius) const {
+        origin = coords(bi) * brick_size_;
+        size = (resolution_ - origin).cwiseMin(Eigen::Vector3i::Constant(brick_size_));
+        Vec3 lo = center(origin.x(), origin.y(), origin.z());
+        Vec3 hi = center(origin.x()+size.x()-1, origin.y()+size.y()-1, origin.z()+size.z()-1);
+        mid = (lo+hi)/2;
+        radius = (hi-lo).norm()/2;
+    }
+
+    /// Fills the bricks in parallel, fill(bi, origin, size, mid, radius, values) writes
+    /// the size.prod() samples of brick bi to \c values, which are then passed to \c emit
+    template <class Fill>
+    void for_each(const Fill& fill, const BrickCallback& emit) const {
+        int n_total = size();
+        #pragma omp parallel
+        {
+            std::vector<Scalar> values;
+            #pragma omp for schedule(dynamic)
+            for(int bi=0; bi<n_total; ++bi){
+                Eigen::Vector3i origin, size;
+                Vec3 mid;
+                Scalar radius;
+                extent(bi, origin, size, mid, radius);
+                values.resize(size.prod());
+                fill(bi, origin, size, mid, radius, values.data());
+                emit(origin, size, values.data());
+            }
+        }
+    }
+
+private:
+    Box3 box_;
+    Eigen::Vector3i resolution_;
+    int brick_size_;
+    Vec3 h_;
+    Eigen::Vector3i n_bricks_;
+};
+
+} // internal
+
+//=============================================================================
+} // namespace OpenGP
+//=============================================================================
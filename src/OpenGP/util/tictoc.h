@@ -4,7 +4,7 @@
 #include <string>
 
 #define tic(x) auto x = std::chrono::steady_clock::now()
-#define toc(x) std::chrono::duration <double, milli> (std::chrono::steady_clock::now() - x).count()
+#define toc(x) std::chrono::duration <double, std::milli> (std::chrono::steady_clock::now() - x).count()
 
 /// Helper class for TICTOC_SCOPE and TICTOC_BLOCK
 class TicTocTimerObject{